@@ -0,0 +1,82 @@
+#pragma once
+
+#include "SearchConfig.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace tafl
+{
+
+struct BatchConfig
+{
+    // The number of positions searched at once, each on one thread, or 0 for all cores
+    unsigned threads {0};
+
+    // The playouts for each position
+    uint64_t playouts {10000};
+
+    // The tree memory for each position
+    size_t memoryLimit {16 * 1024 * 1024};
+
+    // Seed the search of each position with the seed plus its index, so that an archive
+    // always gives the same results
+    std::optional<uint64_t> seed;
+
+    // Score the playouts with an evaluation or a network, as in SearchConfig
+    std::shared_ptr<const Evaluation> evaluation;
+    std::shared_ptr<const NeuralNetwork> network;
+};
+
+struct BatchResult
+{
+    // The line or the record of the position in the input, from 0
+    uint64_t index {0};
+
+    SearchResult search;
+
+    // Why the position couldn't be analysed, if it couldn't
+    std::optional<std::string> error;
+};
+
+/*
+ * Offline analysis of many positions, for the most positions per hour rather than the
+ * quickest answer for one position: the positions are searched side by side, each on
+ * a thread of its own and with a number of playouts.
+ */
+class BatchAnalysis
+{
+public:
+    /**
+     * Analyse the positions read from a stream, either packed or in the text form of
+     * PositionFormat, one per line. Empty lines and lines starting with # are skipped.
+     *
+     * @param in the positions
+     * @param config how to search them
+     * @param onResult called with each result as soon as it's ready, so not in the order
+     *                 of the input, and never concurrently
+     *
+     * @return the number of positions analysed
+     */
+    static uint64_t run(std::istream& in,
+                        const BatchConfig& config,
+                        const std::function<void(const BatchResult& result)>& onResult);
+
+    /**
+     * Format a result as a JSON object on one line, with the best move, its evaluation
+     * and the statistics of the best moves.
+     *
+     * @param result the result to format
+     * @param moves the number of moves to give the statistics of
+     *
+     * @return the JSON object
+     */
+    static std::string toJson(const BatchResult& result, unsigned moves);
+};
+
+} // namespace tafl
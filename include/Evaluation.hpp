@@ -0,0 +1,82 @@
+#pragma once
+
+#include "IBoard.hpp"
+
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tafl
+{
+
+/*
+ * A linear evaluation of positions: the weighted sum of a few features, with the
+ * logistic function of the sum being the chance of white winning.
+ *
+ * The weights are tuned on played games, see EvaluationTuner, and kept in a text file
+ * with a "<feature> <weight>" line for each feature. Lines starting with # are comments.
+ */
+class Evaluation
+{
+public:
+    enum Feature : unsigned
+    {
+        // Always 1
+        Bias,
+        // 1 with white to move, -1 with black to move
+        Tempo,
+        BlackPieces,
+        // Without the king
+        WhitePieces,
+        // The squares from the king to the nearest edge
+        KingEdgeDistance,
+        // The open lines from the king to the edges
+        KingEscapes,
+        // The squares the king can move to
+        KingMobility,
+        // The pieces next to the king
+        KingAttackers,
+        KingDefenders,
+        Count,
+    };
+
+    static constexpr unsigned kFeatures = Feature::Count;
+
+    using Features = std::array<float, kFeatures>;
+
+    using Weights = std::array<float, kFeatures>;
+
+    // Set by hand, for when there are no tuned weights
+    Evaluation();
+
+    explicit Evaluation(const Weights& weights);
+
+    static Features extract(const IBoard& board);
+
+    // The sum of the weighted features, positive when white is ahead
+    float score(const Features& features) const;
+
+    float score(const IBoard& board) const;
+
+    // The chance of a player winning from a position
+    float winRate(const IBoard& board, Color which) const;
+
+    const Weights& getWeights() const;
+
+    static const char* name(Feature feature);
+
+    // Parse the weights file format, or return std::nullopt if a feature is missing
+    static std::optional<Evaluation> fromText(std::string_view text);
+
+    std::string toText() const;
+
+    static std::optional<Evaluation> load(const std::string& path);
+
+    bool save(const std::string& path) const;
+
+private:
+    Weights m_weights;
+};
+
+} // namespace tafl
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Evaluation.hpp"
+#include "GameRecords.hpp"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace tafl
+{
+
+struct TunerConfig
+{
+    // The threads computing the gradient, or 0 for all cores
+    unsigned threads {0};
+
+    // The passes over all positions, each taking one step
+    unsigned epochs {500};
+
+    float learningRate {0.05f};
+};
+
+/*
+ * Tune the weights of the evaluation on the positions of played games, by logistic
+ * regression of the winner on the features (Texel tuning).
+ *
+ * The features of the positions are extracted once and kept in memory by feature,
+ * 40 bytes for each position, so that the scores and the gradient are computed over
+ * consecutive positions. Each epoch computes the gradient of the log loss over all
+ * positions, split between the threads, and takes an Adam step.
+ */
+class EvaluationTuner
+{
+public:
+    /**
+     * Add the positions of the finished games of a record file.
+     *
+     * @param reader the games
+     * @param threads the threads replaying the games, or 0 for all cores
+     * @param skipPlies the positions at the start of each game to skip, which are shared
+     *                  by many games
+     */
+    void addGames(const GameRecordReader& reader, unsigned threads, unsigned skipPlies);
+
+    void addPosition(const IBoard& board, Color winner);
+
+    size_t getPositionCount() const;
+
+    // The mean log loss of the predicted winners
+    double getLoss(const Evaluation& evaluation, unsigned threads) const;
+
+    /**
+     * Tune the weights, starting from an evaluation.
+     *
+     * @param start the initial weights
+     * @param config how to tune
+     * @param onEpoch called after each epoch with its number and the loss before it
+     *
+     * @return the tuned evaluation
+     */
+    Evaluation tune(const Evaluation& start,
+                    const TunerConfig& config,
+                    const std::function<void(unsigned epoch, double loss)>& onEpoch) const;
+
+private:
+    struct Gradient
+    {
+        std::array<double, Evaluation::kFeatures> weights {};
+        double loss {0};
+    };
+
+    // The gradient and the loss summed over all positions
+    Gradient computeGradient(const Evaluation& evaluation, unsigned threads) const;
+
+    // The gradient and the loss summed over a range of positions
+    Gradient computeGradient(const Evaluation& evaluation, size_t begin, size_t end) const;
+
+    // The values of each feature for all positions
+    std::array<std::vector<float>, Evaluation::kFeatures> m_features;
+    // 1 for a white win, 0 for a black win
+    std::vector<float> m_results;
+};
+
+} // namespace tafl
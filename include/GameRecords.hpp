@@ -0,0 +1,208 @@
+#pragma once
+
+#include "IBoard.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tafl
+{
+
+/*
+ * Files of played games, such as from self-play or tournaments, to replay them or to
+ * learn from their positions.
+ *
+ * A file starts with a header holding the variant, the dimension and the starting
+ * position of all its games. The games follow in blocks, each with a header holding its
+ * size, its number of games and positions and a checksum of the games. A game is its
+ * number of moves, its winner and the moves, two bytes each.
+ *
+ * Files are only ever appended to, a block at a time. A block which was cut short, such
+ * as by a crash while it was written, is ignored by the reader and overwritten by the
+ * next writer. A block whose games don't match its checksum is skipped by the reader,
+ * which checks each block the first time it's read. A file which is damaged before its
+ * last block isn't appended to.
+ */
+
+// A game of a record file, read in place
+class GameView
+{
+public:
+    GameView(std::span<const uint8_t> moves, std::optional<Color> winner, unsigned dimension);
+
+    unsigned getPlies() const;
+
+    Move getMove(unsigned ply) const;
+
+    // The winner, or std::nullopt if the game wasn't finished
+    std::optional<Color> getWinner() const;
+
+private:
+    std::span<const uint8_t> m_moves;
+    std::optional<Color> m_winner;
+    unsigned m_dimension;
+};
+
+class GameRecordWriter
+{
+public:
+    ~GameRecordWriter();
+
+    GameRecordWriter(const GameRecordWriter&) = delete;
+
+    GameRecordWriter& operator=(const GameRecordWriter&) = delete;
+
+    /**
+     * Open a file to append games to, creating it if it doesn't exist.
+     *
+     * @param path the file
+     * @param variant the name of the variant, at most 15 characters
+     * @param start the starting position of the games
+     *
+     * @return the writer, or nullptr if the file can't be written, has games of
+     *         another variant or starting position or has a damaged block header
+     */
+    static std::unique_ptr<GameRecordWriter>
+    open(const std::string& path, const std::string& variant, const IBoard& start);
+
+    /**
+     * Add a game, which is written once its block is full. Can be called concurrently.
+     *
+     * @param moves the moves from the starting position, at most 65535
+     * @param winner the winner, or std::nullopt if the game wasn't finished
+     *
+     * @return false if the game can't be recorded or a block failed to be written
+     */
+    bool add(std::span<const Move> moves, std::optional<Color> winner);
+
+    // Write the games added since the last block, returning false on failure
+    bool flush();
+
+private:
+    GameRecordWriter(int fd, unsigned dimension);
+
+    bool writeBlock();
+
+    const int m_fd;
+    const unsigned m_dimension;
+    std::mutex m_mutex;
+    std::vector<uint8_t> m_block;
+    uint32_t m_games {0};
+    uint64_t m_positions {0};
+};
+
+class GameRecordReader
+{
+public:
+    ~GameRecordReader();
+
+    GameRecordReader(const GameRecordReader&) = delete;
+
+    GameRecordReader& operator=(const GameRecordReader&) = delete;
+
+    // Map a file, or return nullptr if it isn't a valid game record file
+    static std::unique_ptr<GameRecordReader> open(const std::string& path);
+
+    const std::string& getVariant() const;
+
+    unsigned getDimension() const;
+
+    // A new board with the starting position of the games
+    std::unique_ptr<IBoard> getStart() const;
+
+    // The number of games, with those of the blocks which are skipped as damaged
+    uint64_t getGameCount() const;
+
+    // The number of positions of all games, with their starting and final positions
+    uint64_t getPositionCount() const;
+
+    /**
+     * A game by its index in the file.
+     *
+     * @return the game, or std::nullopt if the index isn't less than getGameCount() or
+     *         the block of the game is damaged
+     */
+    std::optional<GameView> getGame(uint64_t index) const;
+
+    // Check all blocks against their checksums, which reading them does only as needed
+    bool verify() const;
+
+    /**
+     * Visit all games, split by blocks between threads, which check the blocks and skip
+     * the damaged ones. The games of a thread are visited in order.
+     *
+     * @param threads the number of threads
+     * @param visit called concurrently with the index of each game and the game
+     */
+    void forEachGame(unsigned threads,
+                     const std::function<void(uint64_t index, const GameView& game)>& visit) const;
+
+    /**
+     * Replay all games and visit their positions, split by blocks between threads. A game
+     * stops at the first move which can't be played.
+     *
+     * @param threads the number of threads
+     * @param visit called concurrently with each position, its game and the number of
+     *              moves played to reach it
+     */
+    void forEachPosition(
+        unsigned threads,
+        const std::function<void(const IBoard& board, const GameView& game, unsigned ply)>& visit)
+        const;
+
+private:
+    struct Block
+    {
+        // The offset of the games in the file
+        size_t offset;
+        size_t size;
+        uint64_t firstGame;
+        uint32_t games;
+        uint64_t checksum;
+    };
+
+    GameRecordReader(void* mapping, size_t size);
+
+    enum class BlockState : uint8_t
+    {
+        Unchecked,
+        Intact,
+        Damaged,
+    };
+
+    // Whether a block is intact, checked the first time it's asked
+    bool isIntact(size_t index) const;
+
+    // Whether the games of a block fit in it and match its checksum
+    bool check(const Block& block) const;
+
+    // Visit the intact blocks, handed out to the threads one at a time
+    void forEachBlock(unsigned threads, const std::function<void(const Block& block)>& visit) const;
+
+    // The game at an offset in the file, and the offset of the next game
+    std::pair<GameView, size_t> readGame(size_t offset) const;
+
+    void* m_mapping;
+    const size_t m_size;
+    const uint8_t* m_data;
+    std::string m_variant;
+    unsigned m_dimension {0};
+    std::span<const uint8_t> m_start;
+    std::vector<Block> m_blocks;
+    uint64_t m_games {0};
+    uint64_t m_positions {0};
+    // For each block, as in isIntact()
+    mutable std::vector<std::atomic<BlockState>> m_blockStates;
+    // A block header is damaged, so the blocks after it can't be found
+    bool m_damagedHeader {false};
+};
+
+} // namespace tafl
@@ -3,12 +3,18 @@
 #include "Color.hpp"
 #include "Move.hpp"
 #include "Piece.hpp"
+#include "ProofConfig.hpp"
+#include "SearchConfig.hpp"
+#include "Tablebase.hpp"
 
 #include <chrono>
+#include <cstdint>
 #include <future>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace tafl
@@ -34,6 +40,15 @@ static const std::string kTablut = "   bbb   "
                                    "    b    "
                                    "   bbb   ";
 
+// 7x7
+static const std::string kBrandubh = "   b   "
+                                     "   b   "
+                                     "   w   "
+                                     "bbwkwbb"
+                                     "   w   "
+                                     "   b   "
+                                     "   b   ";
+
 
 class IBoard
 {
@@ -46,8 +61,86 @@ public:
 
     virtual std::vector<Piece> getPieces(const Color& which) const = 0;
 
+    /**
+     * Copy the pieces of a color into a caller-provided buffer.
+     *
+     * @param which the color to get pieces for
+     * @param out the buffer to fill
+     *
+     * @return the filled part of @a out, truncated if @a out is too small
+     */
+    virtual std::span<Piece> getPieces(const Color& which, std::span<Piece> out) const = 0;
+
     virtual std::vector<Move> getPossibleMoves() const = 0;
 
+    /**
+     * Copy the possible moves into a caller-provided buffer.
+     *
+     * @param out the buffer to fill
+     *
+     * @return the filled part of @a out, truncated if @a out is too small
+     */
+    virtual std::span<Move> getPossibleMoves(std::span<Move> out) const = 0;
+
+    /**
+     * Select one of the possible moves without building the list of moves.
+     *
+     * The selected move is getPossibleMoves()[random % n], where n is the number
+     * of possible moves, so a uniformly distributed @a random gives a uniformly
+     * distributed move.
+     *
+     * @param random the random number to select from
+     *
+     * @return the selected move, or std::nullopt if there are no possible moves
+     */
+    virtual std::optional<Move> getRandomMove(uint32_t random) const = 0;
+
+    /**
+     * Copy the moves which take the king directly to an edge into a caller-provided
+     * buffer, regardless of whose turn it is.
+     *
+     * The squares between the king and the destination of an escape are the
+     * squares where black can block it.
+     *
+     * @param out the buffer to fill
+     *
+     * @return the filled part of @a out
+     */
+    virtual std::span<Move> getKingEscapes(std::span<Move> out) const = 0;
+
+    /**
+     * Select a move for black which captures the king, or which blocks its escape if
+     * it has exactly one open line, as the playouts do.
+     *
+     * @param random the random number to select from, uniformly among the moves
+     *
+     * @return the selected move, or std::nullopt if there is none or white is to move
+     */
+    virtual std::optional<Move> getBlockingMove(uint32_t random) const = 0;
+
+    // Invoke @a f for each piece of a color, without allocating
+    template <typename F>
+    void forEachPiece(const Color& which, F&& f) const
+    {
+        visitPieces(which, &IBoard::invoke<F, Piece>, context(f));
+    }
+
+    // Invoke @a f for each possible move, without allocating
+    template <typename F>
+    void forEachPossibleMove(F&& f) const
+    {
+        visitPossibleMoves(&IBoard::invoke<F, Move>, context(f));
+    }
+
+    virtual unsigned getPieceCount(const Color& which) const = 0;
+
+    /**
+     * Return the position of the king.
+     *
+     * @return std::nullopt if the king has been captured
+     */
+    virtual std::optional<Pos> getKingPosition() const = 0;
+
     // Perform a move on the board
     virtual void move(Move move) = 0;
 
@@ -55,6 +148,39 @@ public:
 
     virtual void setTurn(Color which) = 0;
 
+    // Copy the position and the turn, without the state of the searches
+    virtual std::unique_ptr<IBoard> clone() const = 0;
+
+    /**
+     * Replace the position and the turn, without allocating, such as to load many
+     * positions into one board. The state of the searches is dropped.
+     *
+     * @param squares the piece type on each square, row by row, with Piece::Type::Unset
+     *                for empty squares
+     * @param turn the side to move
+     *
+     * @return false if there isn't one type per square of the board, true otherwise
+     */
+    virtual bool setPosition(std::span<const Piece::Type> squares, Color turn) = 0;
+
+    /**
+     * Keep the first layer of a network up to date as pieces are moved and captured, as
+     * the playouts do, or stop with nullptr. The network must outlive the board, or be
+     * detached first.
+     *
+     * @return false if the network is for another dimension, and isn't attached
+     */
+    virtual bool attachNetwork(const NeuralNetwork* network) = 0;
+
+    // The output of the attached network for the side to move, or std::nullopt if none is
+    virtual std::optional<float> getNetworkScore() const = 0;
+
+    // Keep the patterns of PlayoutPolicy up to date as pieces are moved and captured, as
+    // the playouts with SearchConfig::patternPlayouts do, or stop
+    virtual void attachPatterns(bool attach) = 0;
+
+    // The pattern of a square, or std::nullopt if the patterns aren't attached
+    virtual std::optional<uint16_t> getPattern(const Pos& pos) const = 0;
 
     /**
      * Return the winner of the current board.
@@ -75,10 +201,61 @@ public:
     calculateBestMove(const std::chrono::milliseconds& quota,
                       std::function<void()> onFutureReady) = 0;
 
+    /**
+     * @brief Search for the best move for the current color
+     *
+     * @param config the search configuration
+     *
+     * @return a future with the best move and the statistics of the search
+     */
+    virtual std::future<SearchResult> search(const SearchConfig& config) = 0;
+
+    /**
+     * @brief Prove or disprove that a player wins within a number of moves
+     *
+     * Uses a depth-first proof-number search, which finds forced sequences that
+     * random playouts rarely do.
+     *
+     * @param config the player and the number of moves to prove a win for
+     *
+     * @return the result, with the winning or saving move if there is one
+     */
+    virtual ProofResult prove(const ProofConfig& config) const = 0;
+
+    /**
+     * Look up the current board in the loaded tablebases.
+     *
+     * @return the result with perfect play, or std::nullopt if the position isn't in a
+     *         loaded tablebase or is drawn
+     */
+    virtual std::optional<TablebaseResult> probeTablebase() const = 0;
+
 
     static std::unique_ptr<IBoard> fromString(const std::string_view& s);
 
     static void printBoard(const IBoard& board);
+
+protected:
+    template <typename T>
+    using Visitor = void (*)(void* context, const T& value);
+
+    virtual void
+    visitPieces(const Color& which, Visitor<Piece> visitor, void* context) const = 0;
+
+    virtual void visitPossibleMoves(Visitor<Move> visitor, void* context) const = 0;
+
+private:
+    template <typename F>
+    static void* context(F& f)
+    {
+        return const_cast<void*>(static_cast<const void*>(&f));
+    }
+
+    template <typename F, typename T>
+    static void invoke(void* context, const T& value)
+    {
+        (*static_cast<std::remove_reference_t<F>*>(context))(value);
+    }
 };
 
 } // namespace tafl
\ No newline at end of file
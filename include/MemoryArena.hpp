@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace tafl
+{
+
+/*
+ * A block of memory which is allocated once and then reused, e.g., between
+ * searches.
+ *
+ * The memory is backed by huge pages when possible, first by explicit huge pages
+ * and then by transparent huge pages, and is prefaulted when the arena is created.
+ * Allocation is a pointer bump, and reset() releases everything at once.
+ *
+ * If the memory can't be mapped, the arena is empty and all allocations fail.
+ */
+class MemoryArena
+{
+public:
+    // Returns a leased arena to the pool
+    struct Releaser
+    {
+        void operator()(MemoryArena* arena) const;
+    };
+
+    using Lease = std::unique_ptr<MemoryArena, Releaser>;
+
+    explicit MemoryArena(size_t size);
+
+    MemoryArena(const MemoryArena&) = delete;
+
+    MemoryArena& operator=(const MemoryArena&) = delete;
+
+    ~MemoryArena();
+
+    /**
+     * Allocate memory from the arena.
+     *
+     * @param size the number of bytes
+     * @param alignment the alignment of the memory, a power of two
+     *
+     * @return the memory, or nullptr if the arena is full
+     */
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Allocate and construct a T in the arena, nullptr if the arena is full
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        auto p = allocate(sizeof(T), alignof(T));
+
+        if (!p)
+        {
+            return nullptr;
+        }
+
+        return new (p) T(std::forward<Args>(args)...);
+    }
+
+    // Release all allocations. Destructors are not called.
+    void reset();
+
+    size_t size() const;
+
+    size_t used() const;
+
+    // Is the arena backed by explicit huge pages?
+    bool hasHugePages() const;
+
+    /**
+     * Lease an arena from a pool shared by the process, so that the memory is mapped and
+     * prefaulted once for many searches. The arena returned last with the same size is
+     * reused. Otherwise the pooled arenas are unmapped before a new one is mapped, so
+     * that the pool only keeps the memory of the latest size.
+     *
+     * @param size the number of bytes
+     *
+     * @return the arena, reset, or nullptr if the memory can't be mapped
+     */
+    static Lease acquire(size_t size);
+
+private:
+    std::byte* m_memory {nullptr};
+    size_t m_size {0};
+    size_t m_used {0};
+    bool m_hugePages {false};
+};
+
+} // namespace tafl
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "IBoard.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tafl
+{
+
+/*
+ * A small quantized network evaluating positions, with the first layer kept up to date
+ * as pieces are moved and captured (an NNUE).
+ *
+ * The inputs are one for each piece type on each square. The first layer sums the
+ * weights of the occupied inputs into an accumulator of kHidden int16 values, so moving
+ * a piece only subtracts one row of weights and adds another. The accumulator is
+ * clipped to [0, kActivationMax], which stands for [0, 1], and the output for the side
+ * to move is its dot product with the output weights, which are scaled by
+ * kWeightScale. The logistic function of the output is the chance of white winning.
+ *
+ * The kernels use AVX2 if the processor has it, and plain loops otherwise.
+ *
+ * A network file starts with a header holding the dimension and kHidden, followed by
+ * the hidden biases, the hidden weights, the output weights and the output biases, all
+ * little-endian as in Parameters.
+ */
+class NeuralNetwork
+{
+public:
+    static constexpr unsigned kHidden = 128;
+
+    static constexpr int kActivationMax = 255;
+
+    static constexpr int kWeightScale = 64;
+
+    struct alignas(32) Accumulator
+    {
+        std::array<int16_t, kHidden> values;
+    };
+
+    struct Parameters
+    {
+        unsigned dimension {0};
+
+        std::array<int16_t, kHidden> hiddenBiases {};
+
+        // kHidden weights for each input, black pieces, then white pieces and then the
+        // king, each row by row
+        std::vector<int16_t> hiddenWeights;
+
+        // kHidden weights with white to move, then with black to move
+        std::array<int16_t, 2 * kHidden> outputWeights {};
+
+        std::array<int32_t, 2> outputBiases {};
+    };
+
+    // Create a network, or return nullptr if the weights don't fit the dimension
+    static std::unique_ptr<NeuralNetwork> create(Parameters parameters);
+
+    // Read a network file, or return nullptr if it isn't valid
+    static std::unique_ptr<NeuralNetwork> load(const std::string& path);
+
+    static std::unique_ptr<NeuralNetwork> fromBytes(std::span<const uint8_t> bytes);
+
+    std::vector<uint8_t> toBytes() const;
+
+    bool save(const std::string& path) const;
+
+    const Parameters& getParameters() const;
+
+    // The number of inputs for a dimension
+    static size_t inputCount(unsigned dimension);
+
+    // Set the accumulator from all pieces of a board of the same dimension
+    void refresh(const IBoard& board, Accumulator& accumulator) const;
+
+    void addPiece(Accumulator& accumulator, Piece::Type type, const Pos& pos) const;
+
+    void removePiece(Accumulator& accumulator, Piece::Type type, const Pos& pos) const;
+
+    void movePiece(Accumulator& accumulator,
+                   Piece::Type type,
+                   const Pos& from,
+                   const Pos& to) const;
+
+    // The output for a side to move, positive when white is ahead
+    float score(const Accumulator& accumulator, Color turn) const;
+
+    // The chance of a player winning
+    float winRate(const Accumulator& accumulator, Color turn, Color which) const;
+
+    // The chance of a player winning from a position, without an accumulator to update
+    float winRate(const IBoard& board, Color which) const;
+
+    // Whether the processor has AVX2, which the kernels use unless told otherwise
+    static bool hasAvx2();
+
+    /**
+     * Use the AVX2 kernels if the processor has them, or the plain loops, such as to
+     * compare them. Not to be called while networks are used.
+     *
+     * @return whether the AVX2 kernels are now used
+     */
+    static bool useAvx2(bool use);
+
+private:
+    explicit NeuralNetwork(Parameters parameters);
+
+    const int16_t* row(Piece::Type type, const Pos& pos) const;
+
+    Parameters m_parameters;
+};
+
+} // namespace tafl
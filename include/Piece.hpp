@@ -4,6 +4,7 @@
 
 #include <Color.hpp>
 #include <memory>
+#include <optional>
 
 namespace tafl
 {
@@ -37,6 +38,8 @@ public:
 
 
     static std::unique_ptr<Piece> fromChar(char c);
+    // The type of a piece character, or std::nullopt for an empty square
+    static std::optional<Type> typeFromChar(char c);
     static char toChar(Type t);
 
 protected:
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Color.hpp>
+#include <Move.hpp>
+#include <Piece.hpp>
+#include <array>
+#include <cstdint>
+
+namespace tafl
+{
+
+/*
+ * The weights of the moves of the playouts, from the pieces around their destinations.
+ *
+ * The pattern of a square holds the squares at a distance of 1 and 2 from it along its
+ * row and its column, which decide the captures made by moving there and whether the
+ * piece can be captured next. Each takes two bits, with the piece type of the square or
+ * 0 for an empty square or off the board. The low byte is the row and the high byte the
+ * column.
+ *
+ * The score of each line of 4 squares is computed once for each side from rules, and
+ * the weight of a move is the weight for the sum of the scores of its row and column.
+ * The tables are small enough to stay in the cache between playouts.
+ */
+class PlayoutPolicy
+{
+public:
+    // Right, left, down and up, as in the bits of a pattern
+    static constexpr unsigned kDirections = 4;
+
+    static constexpr unsigned kMaxWeight = 255;
+
+    // The bit of the 2-bit code of the square at a distance in a direction in a pattern
+    static constexpr unsigned
+    shift(unsigned direction, unsigned distance)
+    {
+        return (direction * 2 + distance - 1) * 2;
+    }
+
+    static constexpr uint16_t
+    code(Piece::Type type)
+    {
+        return static_cast<uint16_t>(type);
+    }
+
+    // The weight of moving a piece of a color to a square with a pattern, at least 1
+    static unsigned
+    weight(Color mover, uint16_t pattern)
+    {
+        auto& scores = kLineScores[static_cast<unsigned>(mover)];
+
+        return kWeights[scores[pattern & 0xff] + scores[pattern >> 8]];
+    }
+
+    // The pattern of the destination of a move once the piece has left its square
+    static uint16_t
+    afterMove(uint16_t pattern, const Move& move)
+    {
+        const auto& [from, to] = move;
+        // The squares it leaves along the row or the column
+        auto distance = from.y == to.y ? from.x - to.x : from.y - to.y;
+        auto direction = from.y == to.y ? 0u : 2u;
+
+        if (static_cast<int>(distance) < 0)
+        {
+            distance = -distance;
+            direction++;
+        }
+        if (distance > 2)
+        {
+            return pattern;
+        }
+
+        return static_cast<uint16_t>(pattern & ~(3u << shift(direction, distance)));
+    }
+
+private:
+    // The scores of the lines are in quarters of a doubling of the weight, offset by
+    // kMinLineScore so that they aren't negative
+    static constexpr int kMinLineScore = -8;
+    static constexpr int kMaxLineScore = 16;
+
+    // For each color, the score of each line
+    static const std::array<std::array<uint8_t, 256>, 2> kLineScores;
+
+    // The weight for each sum of the scores of a row and a column
+    static const std::array<uint8_t, 2 * (kMaxLineScore - kMinLineScore) + 1> kWeights;
+};
+
+} // namespace tafl
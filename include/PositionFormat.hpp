@@ -0,0 +1,86 @@
+#pragma once
+
+#include "IBoard.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace tafl
+{
+
+/*
+ * Positions with the side to move, as text or packed into a few bytes.
+ *
+ * The text form is the board as for IBoard::fromString(), optionally followed by ";w"
+ * or ";b" for the side to move, which is white otherwise.
+ *
+ * The packed form has a fixed size for each dimension. Each square takes two bits, row
+ * by row and four to a byte from the least significant bits: 0 for empty, 1 for black,
+ * 2 for white and 3 for the king. The bit after the last square is set for black to
+ * move. Packing and unpacking don't allocate.
+ *
+ * Files of packed positions start with a header, which holds the dimension, and
+ * continue with the positions back to back.
+ */
+class PositionFormat
+{
+public:
+    static constexpr unsigned kMaxDimension = 18;
+
+    static constexpr size_t kHeaderSize = 8;
+
+    // The bytes of a packed position
+    static constexpr size_t
+    packedSize(unsigned dimension)
+    {
+        return (2 * dimension * dimension + 1 + 7) / 8;
+    }
+
+    static constexpr size_t kMaxPackedSize = (2 * kMaxDimension * kMaxDimension + 1 + 7) / 8;
+
+    /**
+     * Pack a position.
+     *
+     * @param board the position
+     * @param out where to pack it, with room for packedSize() bytes
+     *
+     * @return false if the position doesn't fit, true otherwise
+     */
+    static bool pack(const IBoard& board, std::span<uint8_t> out);
+
+    /**
+     * Unpack a position into a board of the same dimension, replacing its position.
+     *
+     * @param in the packed position
+     * @param board the board to set up
+     *
+     * @return false if the input is too short, true otherwise
+     */
+    static bool unpack(std::span<const uint8_t> in, IBoard& board);
+
+    // Unpack a position into a new board, or return nullptr if the input is too short
+    static std::unique_ptr<IBoard> unpack(std::span<const uint8_t> in, unsigned dimension);
+
+    // The text form of a position, with the side to move
+    static std::string toText(const IBoard& board);
+
+    // Parse the text form of a position, or return nullptr if it isn't valid
+    static std::unique_ptr<IBoard> fromText(std::string_view text);
+
+    // The header of a file of packed positions
+    static std::array<uint8_t, kHeaderSize> header(unsigned dimension);
+
+    // The dimension in the header of a file of packed positions, if it is one
+    static std::optional<unsigned> parseHeader(std::span<const uint8_t> in);
+
+    // Can a stream be a file of packed positions, from its first byte?
+    static bool isHeaderStart(int c);
+};
+
+} // namespace tafl
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Color.hpp"
+#include "Move.hpp"
+
+#include <cstdint>
+#include <optional>
+
+namespace tafl
+{
+
+struct ProofConfig
+{
+    // The player who should win, i.e., white by escaping or black by capturing the king
+    Color attacker {Color::White};
+
+    // The number of moves by the attacker to win within
+    unsigned moves {3};
+
+    // The search gives up after visiting this many positions
+    uint64_t nodeLimit {1000000};
+};
+
+enum class Proof : uint8_t
+{
+    // The node limit was reached
+    Unknown,
+    // The attacker wins within the moves, whatever the defender does
+    Proven,
+    // The defender can avoid losing within the moves
+    Disproven,
+};
+
+struct ProofResult
+{
+    Proof proof {Proof::Unknown};
+
+    // The winning move if proven with the attacker to move, or the saving move if
+    // disproven with the defender to move
+    std::optional<Move> move;
+
+    // The number of positions visited
+    uint64_t nodes {0};
+};
+
+} // namespace tafl
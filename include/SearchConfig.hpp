@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Move.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace tafl
+{
+
+class Evaluation;
+class NeuralNetwork;
+struct SearchProgress;
+
+struct SearchConfig
+{
+    // The time allowed for the search
+    std::chrono::milliseconds quota {2000};
+
+    // The number of threads searching the shared tree
+    unsigned threads {6};
+
+    /*
+     * The memory for the search tree, at least 16 kB. The least visited subtrees are
+     * recycled when it's full.
+     */
+    size_t memoryLimit {128 * 1024 * 1024};
+
+    // Stop after this many playouts instead of after the quota, if not 0
+    uint64_t playouts {0};
+
+    /*
+     * Seed the playouts and let each thread search a tree of its own, with its share of
+     * the memory, merging the statistics of the trees in order. Together with a number
+     * of playouts, the same position then always gives the same result.
+     */
+    std::optional<uint64_t> seed;
+
+    /*
+     * Called with a snapshot of the search every progressInterval, from a thread which
+     * doesn't search. Returning false stops the search early, with the result so far.
+     */
+    std::function<bool(const SearchProgress& progress)> onProgress;
+
+    std::chrono::milliseconds progressInterval {100};
+
+    // The number of best moves whose principal variations are in a snapshot
+    unsigned principalVariations {3};
+
+    /*
+     * End the playouts after playoutDepth random moves and score them with this
+     * evaluation, if set, instead of playing them to the end.
+     */
+    std::shared_ptr<const Evaluation> evaluation;
+
+    // Score the playouts with this network instead of the evaluation, if set
+    std::shared_ptr<const NeuralNetwork> network;
+
+    unsigned playoutDepth {16};
+
+    /*
+     * Prefer the moves of the playouts by the pieces around their destinations, such as
+     * captures, instead of choosing them uniformly at random. The playouts are slower,
+     * so this pays off only if they become more telling.
+     */
+    bool patternPlayouts {false};
+};
+
+// The proven result of a move, for the player making it
+enum class Outcome : uint8_t
+{
+    Unknown,
+    Win,
+    Loss,
+};
+
+struct MoveStatistics
+{
+    Move move;
+    uint32_t visits {0};
+    // The share of wins for the side to move, between 0 and 1
+    float winRate {0};
+    Outcome outcome {Outcome::Unknown};
+};
+
+struct SearchResult
+{
+    // std::nullopt if there are no possible moves, or no memory for the search tree
+    std::optional<Move> bestMove;
+
+    // The statistics for each possible move, proven wins first, then the most visited and
+    // proven losses last. Moves which lead to symmetric positions share their statistics.
+    std::vector<MoveStatistics> moves;
+
+    uint64_t playouts {0};
+    std::chrono::milliseconds elapsed {0};
+
+    // The number of times the tree was full and subtrees were recycled
+    unsigned recycles {0};
+
+    // The number of positions which shared the statistics of a transposition
+    uint64_t transpositions {0};
+
+    // The playouts inherited from the previous search, through the moves played since
+    uint32_t reusedVisits {0};
+};
+
+// A snapshot of a running search
+struct SearchProgress
+{
+    std::optional<Move> bestMove;
+
+    // The statistics for each possible move so far, in the order of SearchResult::moves
+    std::vector<MoveStatistics> moves;
+
+    // The most visited lines of moves after the best moves, each starting with the move
+    std::vector<std::vector<Move>> principalVariations;
+
+    uint64_t playouts {0};
+    std::chrono::milliseconds elapsed {0};
+    double playoutsPerSecond {0};
+};
+
+} // namespace tafl
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace tafl
+{
+
+/*
+ * Precomputed moves along a row or column for an N-sized line.
+ *
+ * The table is indexed by the position of the moving piece on the line and the
+ * occupancy of the line (bit i set for an occupied square i). Each entry holds the
+ * squares which can be reached by sliding from the position, again as a bitmask.
+ */
+template <unsigned N>
+class SlidingMoveTable
+{
+public:
+    static_assert(N >= 2 && N <= 16, "A line must fit in 16 bits");
+
+    static constexpr unsigned kOccupancies = 1u << N;
+
+    static constexpr uint16_t reachable(unsigned pos, uint32_t occupancy)
+    {
+        return kTable[pos * kOccupancies + occupancy];
+    }
+
+    static constexpr std::span<const uint16_t> table()
+    {
+        return kTable;
+    }
+
+private:
+    static constexpr auto build()
+    {
+        std::array<uint16_t, N * kOccupancies> out {};
+
+        for (auto pos = 0u; pos < N; pos++)
+        {
+            for (auto occupancy = 0u; occupancy < kOccupancies; occupancy++)
+            {
+                uint16_t reach = 0;
+
+                for (auto i = pos + 1; i < N && !(occupancy & (1u << i)); i++)
+                {
+                    reach |= 1u << i;
+                }
+                for (auto i = pos; i > 0 && !(occupancy & (1u << (i - 1))); i--)
+                {
+                    reach |= 1u << (i - 1);
+                }
+
+                out[pos * kOccupancies + occupancy] = reach;
+            }
+        }
+
+        return out;
+    }
+
+    static constexpr std::array<uint16_t, N * kOccupancies> kTable = build();
+};
+
+/**
+ * Return the sliding move table for a board dimension.
+ *
+ * @param dimension the board dimension
+ *
+ * @return the table, indexed as SlidingMoveTable<dimension>, or an empty span if
+ * the dimension is too large to use a table
+ */
+constexpr std::span<const uint16_t>
+slidingMoveTable(unsigned dimension)
+{
+    switch (dimension)
+    {
+    case 3:
+        return SlidingMoveTable<3>::table();
+    case 4:
+        return SlidingMoveTable<4>::table();
+    case 5:
+        return SlidingMoveTable<5>::table();
+    case 6:
+        return SlidingMoveTable<6>::table();
+    case 7:
+        return SlidingMoveTable<7>::table();
+    case 8:
+        return SlidingMoveTable<8>::table();
+    case 9:
+        return SlidingMoveTable<9>::table();
+    case 10:
+        return SlidingMoveTable<10>::table();
+    case 11:
+        return SlidingMoveTable<11>::table();
+    case 12:
+        return SlidingMoveTable<12>::table();
+    case 13:
+        return SlidingMoveTable<13>::table();
+    default:
+        break;
+    }
+
+    return {};
+}
+
+} // namespace tafl
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Color.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace tafl
+{
+
+// The result of a position with perfect play by both sides
+struct TablebaseResult
+{
+    Color winner;
+    // The number of moves, by both sides, until the game is won
+    unsigned plies;
+};
+
+/*
+ * Endgame tablebases, with the results of all positions on a small board with the king
+ * and a few other pieces.
+ *
+ * Loaded tablebases are probed by all boards, both in the search and in the playouts.
+ */
+class Tablebases
+{
+public:
+    // The largest board dimension which tablebases can be generated for
+    static constexpr unsigned kMaxDimension = 8;
+
+    // The largest number of pieces of each color, besides the king
+    static constexpr unsigned kMaxPieces = 4;
+
+    /*
+     * The most memory which the tablebases of one generation may take. Not all
+     * combinations of the limits above fit, e.g., 4 white and 4 black pieces fit only on
+     * very small boards.
+     */
+    static constexpr uint64_t kMaxGeneratedSize = uint64_t {4} << 30;
+
+    /**
+     * The memory taken by generating tablebases within the limits above, one byte for
+     * each position of each of them, which are all kept until the generation is done.
+     *
+     * @param dimension the board dimension
+     * @param whites the largest number of white pieces besides the king
+     * @param blacks the largest number of black pieces
+     *
+     * @return the size in bytes
+     */
+    static uint64_t generatedSize(unsigned dimension, unsigned whites, unsigned blacks);
+
+    /**
+     * Generate the tablebases for all positions with the king and up to a number of
+     * white and black pieces, and write them to a directory.
+     *
+     * @param dimension the board dimension
+     * @param whites the largest number of white pieces besides the king
+     * @param blacks the largest number of black pieces
+     * @param directory where to write the tablebase files
+     * @param threads the number of threads to generate with
+     *
+     * @return true if all tablebases were written, false if writing failed, the
+     *         limits are exceeded, or the tablebases take more than kMaxGeneratedSize
+     */
+    static bool generate(unsigned dimension,
+                         unsigned whites,
+                         unsigned blacks,
+                         const std::string& directory,
+                         unsigned threads);
+
+    /**
+     * Memory-map the tablebase files in a directory. Must not be called while
+     * searching.
+     *
+     * @param directory where the tablebase files are
+     *
+     * @return the number of tablebases loaded
+     */
+    static unsigned load(const std::string& directory);
+
+    // Unmap all tablebases. Must not be called while searching.
+    static void unload();
+};
+
+} // namespace tafl
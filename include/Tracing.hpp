@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+namespace tafl
+{
+
+/*
+ * The timings of the phases of the engine, such as move generation, captures and
+ * hash probes, recorded per thread.
+ *
+ * Recording is only compiled in with the TAFL_TRACE CMake option, and costs nothing
+ * otherwise. None of these must be called while searching.
+ */
+class Tracing
+{
+public:
+    // Is recording compiled in?
+    static bool isEnabled();
+
+    /**
+     * Write the recorded phases as Chrome trace events, which chrome://tracing and
+     * Perfetto can show. Each thread keeps its first events only, so trace short runs.
+     *
+     * @param path the JSON file to write
+     *
+     * @return true if the file was written, false otherwise or if recording isn't
+     *         compiled in
+     */
+    static bool writeChromeTrace(const std::string& path);
+
+    // A histogram of the durations of each phase and the counters, per thread
+    static std::string formatHistograms();
+
+    // Forget everything recorded so far
+    static void reset();
+};
+
+} // namespace tafl
@@ -0,0 +1,222 @@
+#include <BatchAnalysis.hpp>
+#include <IBoard.hpp>
+#include <PositionFormat.hpp>
+#include <algorithm>
+#include <array>
+#include <fmt/format.h>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace tafl;
+
+namespace
+{
+
+const char*
+toString(Outcome outcome)
+{
+    switch (outcome)
+    {
+    case Outcome::Win:
+        return "win";
+    case Outcome::Loss:
+        return "loss";
+    default:
+        return "unknown";
+    }
+}
+
+std::string
+toJson(const Move& move)
+{
+    return fmt::format(
+        "{{\"from\":[{},{}],\"to\":[{},{}]}}", move.from.x, move.from.y, move.to.x, move.to.y);
+}
+
+// The characters of an error message which JSON needs escaped
+std::string
+escape(const std::string& s)
+{
+    std::string out;
+
+    for (auto c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+        }
+        out += c;
+    }
+
+    return out;
+}
+
+} // namespace
+
+uint64_t
+BatchAnalysis::run(std::istream& in,
+                   const BatchConfig& config,
+                   const std::function<void(const BatchResult& result)>& onResult)
+{
+    const auto threads =
+        config.threads ? config.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    std::mutex inputMutex;
+    std::mutex outputMutex;
+    uint64_t records = 0;
+
+    // Packed positions if the stream starts with their header, text lines otherwise
+    std::optional<unsigned> dimension;
+    if (PositionFormat::isHeaderStart(in.peek()))
+    {
+        std::array<uint8_t, PositionFormat::kHeaderSize> header;
+
+        in.read(reinterpret_cast<char*>(header.data()), header.size());
+        dimension = PositionFormat::parseHeader(header);
+        if (!dimension)
+        {
+            onResult({.index = 0, .search = {}, .error = "invalid header"});
+            return 0;
+        }
+    }
+
+    auto search = [&config](IBoard& board, uint64_t index) {
+        SearchConfig searchConfig;
+        searchConfig.threads = 1;
+        searchConfig.playouts = config.playouts;
+        searchConfig.memoryLimit = config.memoryLimit;
+        searchConfig.evaluation = config.evaluation;
+        searchConfig.network = config.network;
+        if (config.seed)
+        {
+            searchConfig.seed = *config.seed + index;
+        }
+
+        return board.search(searchConfig).get();
+    };
+
+    // Reading a position takes much less than searching it, so the workers share the
+    // stream
+    auto work = [&]() {
+        uint64_t analysed = 0;
+        // Reused for all the packed positions
+        std::unique_ptr<IBoard> packedBoard;
+
+        while (true)
+        {
+            std::string line;
+            std::array<uint8_t, PositionFormat::kMaxPackedSize> packed;
+            BatchResult result;
+            {
+                std::lock_guard lock(inputMutex);
+
+                if (dimension)
+                {
+                    auto size = PositionFormat::packedSize(*dimension);
+                    if (!in.read(reinterpret_cast<char*>(packed.data()), size))
+                    {
+                        return analysed;
+                    }
+                    result.index = records++;
+                }
+                else
+                {
+                    do
+                    {
+                        if (!std::getline(in, line))
+                        {
+                            return analysed;
+                        }
+                        result.index = records++;
+                    } while (line.empty() || line.starts_with('#'));
+                }
+            }
+
+            if (dimension)
+            {
+                if (!packedBoard)
+                {
+                    packedBoard = PositionFormat::unpack(packed, *dimension);
+                }
+                else
+                {
+                    PositionFormat::unpack(packed, *packedBoard);
+                }
+                result.search = search(*packedBoard, result.index);
+            }
+            else if (auto board = PositionFormat::fromText(line))
+            {
+                result.search = search(*board, result.index);
+            }
+            else
+            {
+                result.error = "invalid position";
+            }
+
+            std::lock_guard lock(outputMutex);
+            onResult(result);
+            analysed++;
+        }
+    };
+
+    std::vector<std::future<uint64_t>> workers;
+    for (auto thr = 0u; thr < threads; thr++)
+    {
+        workers.push_back(std::async(std::launch::async, work));
+    }
+
+    uint64_t out = 0;
+    for (auto& worker : workers)
+    {
+        out += worker.get();
+    }
+
+    return out;
+}
+
+std::string
+BatchAnalysis::toJson(const BatchResult& result, unsigned moves)
+{
+    if (result.error)
+    {
+        return fmt::format(
+            "{{\"index\":{},\"error\":\"{}\"}}", result.index, escape(*result.error));
+    }
+
+    auto& search = result.search;
+    auto out = fmt::format("{{\"index\":{}", result.index);
+
+    if (search.bestMove)
+    {
+        auto& best = search.moves.front();
+
+        out += fmt::format(",\"bestMove\":{},\"winRate\":{:.4f},\"outcome\":\"{}\"",
+                           ::toJson(best.move),
+                           best.winRate,
+                           toString(best.outcome));
+    }
+    else
+    {
+        out += ",\"bestMove\":null";
+    }
+    out += fmt::format(",\"playouts\":{},\"elapsedMs\":{},\"transpositions\":{},\"moves\":[",
+                       search.playouts,
+                       search.elapsed.count(),
+                       search.transpositions);
+
+    for (auto i = 0u; i < std::min<size_t>(moves, search.moves.size()); i++)
+    {
+        auto& move = search.moves[i];
+
+        out += fmt::format("{}{{\"move\":{},\"visits\":{},\"winRate\":{:.4f},\"outcome\":\"{}\"}}",
+                           i ? "," : "",
+                           ::toJson(move.move),
+                           move.visits,
+                           move.winRate,
+                           toString(move.outcome));
+    }
+    out += "]}";
+
+    return out;
+}
@@ -1,44 +1,176 @@
 
 #include "Board.hpp"
 
+#include "ProofNumberSearch.hpp"
+#include "SearchTree.hpp"
+#include "Tablebase.hpp"
+#include "Trace.hpp"
+
+#include <Evaluation.hpp>
 #include <IBoard.hpp>
+#include <PlayoutPolicy.hpp>
+#include <algorithm>
+#include <bit>
 #include <cassert>
-#include <cmath>
 #include <fmt/format.h>
 #include <future>
+#include <limits>
 #include <map>
+#include <mutex>
+#include <random>
 #include <ranges>
 #include <set>
 #include <vector>
 
 using namespace tafl;
 
-Board::Board(unsigned dimensions, std::vector<std::unique_ptr<Piece>>& pieces)
-    : m_dimensions(dimensions)
-    , m_moveTrait(IMoveTrait::create())
+namespace
+{
+
+unsigned
+nthSetBit(uint32_t mask, unsigned n)
+{
+    for (; n; n--)
+    {
+        mask &= mask - 1;
+    }
+
+    return std::countr_zero(mask);
+}
+
+constexpr uint64_t
+splitMix64(uint64_t& state)
+{
+    auto z = (state += 0x9e3779b97f4a7c15ull);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+
+    return z ^ (z >> 31);
+}
+
+// The playouts for one of the search threads, or no limit
+uint64_t
+playoutShare(uint64_t playouts, unsigned thread, unsigned threads)
+{
+    if (playouts == 0)
+    {
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    return playouts / threads + (thread < playouts % threads ? 1 : 0);
+}
+
+// Call onProgress every interval until the search threads are done, or until it stops them
+void
+reportProgress(const SearchConfig& config,
+               std::chrono::steady_clock::time_point start,
+               const std::vector<std::shared_ptr<SearchTree>>& trees,
+               uint32_t reusedVisits,
+               std::vector<std::future<uint64_t>>& threadFutures,
+               std::stop_source& stop)
 {
-    unsigned index = 0;
-    for (auto& p : pieces)
+    if (!config.onProgress)
+    {
+        return;
+    }
+
+    const auto interval = std::max(config.progressInterval, std::chrono::milliseconds(1));
+    for (auto next = start + interval;; next += interval)
+    {
+        auto finished = std::ranges::all_of(threadFutures, [next](auto& f) {
+            return f.wait_until(next) == std::future_status::ready;
+        });
+        if (finished)
+        {
+            return;
+        }
+
+        auto progress = SearchTree::getProgress(trees, config.principalVariations);
+        for (auto& tree : trees)
+        {
+            progress.playouts += tree->getRootVisits();
+        }
+        progress.playouts -= std::min<uint64_t>(progress.playouts, reusedVisits);
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        progress.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+        progress.playoutsPerSecond =
+            progress.playouts / std::max(std::chrono::duration<double>(elapsed).count(), 1e-9);
+
+        if (!config.onProgress(progress))
+        {
+            stop.request_stop();
+            return;
+        }
+    }
+}
+
+// One key per square and piece type, and the last one for black to move
+constexpr auto kZobristKeys = []() {
+    std::array<uint64_t, 18 * 18 * 4 + 1> keys {};
+    uint64_t state = 0x7af1;
+
+    for (auto& key : keys)
     {
-        m_pieceStorage[index] = *p;
-        m_pieces.push_back(&m_pieceStorage[index]);
-        m_board[p->getPosition().flatten(m_dimensions)] = &m_pieceStorage[index];
-        index++;
+        key = splitMix64(state);
     }
+
+    return keys;
+}();
+
+constexpr auto kBlackToMoveKey = kZobristKeys.back();
+
+} // namespace
+
+Board::Board(unsigned dimensions, std::span<const Piece::Type> squares, Color turn)
+    : m_dimensions(dimensions)
+    , m_slidingMoves(slidingMoveTable(dimensions))
+    , m_moveTrait(IMoveTrait::create())
+{
+    setPosition(squares, turn);
 }
 
 Board::Board(const Board& other)
     : m_dimensions(other.m_dimensions)
     , m_turn(other.m_turn)
+    , m_hash(other.m_turn == Color::Black ? kBlackToMoveKey : 0)
+    , m_slidingMoves(other.m_slidingMoves)
+    , m_network(other.m_network)
+    , m_hasPatterns(other.m_hasPatterns)
     , m_moveTrait(IMoveTrait::create())
 {
-    unsigned index = 0;
+    TAFL_TRACE_SCOPE(BoardCopy);
+
     for (auto& p : other.m_pieces)
     {
-        m_pieceStorage[index] = *p;
-        m_pieces.push_back(&m_pieceStorage[index]);
-        m_board[p->getPosition().flatten(m_dimensions)] = &m_pieceStorage[index];
-        index++;
+        addPiece(*p);
+    }
+    if (m_network)
+    {
+        m_accumulator = other.m_accumulator;
+    }
+    if (m_hasPatterns)
+    {
+        m_patterns = other.m_patterns;
+    }
+}
+
+void
+Board::addPiece(const Piece& piece)
+{
+    auto p = &m_pieceStorage[m_pieces.size()];
+
+    *p = piece;
+    m_pieces.push_back(p);
+    m_board[p->getPosition().flatten(m_dimensions)] = p;
+    setOccupied(p->getPosition(), true);
+    m_pieceCount[static_cast<unsigned>(p->getColor())]++;
+    togglePieceHash(*p);
+
+    if (p->getType() == Piece::Type::King)
+    {
+        m_king = p;
     }
 }
 
@@ -78,9 +210,60 @@ Board::getPieces(const Color& which) const
     return out;
 }
 
+std::span<Piece>
+Board::getPieces(const Color& which, std::span<Piece> out) const
+{
+    auto n = 0u;
+
+    for (auto& piece : m_pieces)
+    {
+        if (n == out.size())
+        {
+            break;
+        }
+        if (piece->getColor() == which)
+        {
+            out[n++] = *piece;
+        }
+    }
+
+    return out.first(n);
+}
+
+unsigned
+Board::getPieceCount(const Color& which) const
+{
+    return m_pieceCount[static_cast<unsigned>(which)];
+}
+
+std::optional<Pos>
+Board::getKingPosition() const
+{
+    if (m_king)
+    {
+        return m_king->getPosition();
+    }
+
+    return std::nullopt;
+}
+
+void
+Board::visitPieces(const Color& which, Visitor<Piece> visitor, void* context) const
+{
+    for (auto& piece : m_pieces)
+    {
+        if (piece->getColor() == which)
+        {
+            visitor(context, *piece);
+        }
+    }
+}
+
 void
 Board::move(Move move)
 {
+    TAFL_TRACE_SCOPE(Move);
+
     auto src = move.from.flatten(m_dimensions);
     auto dst = move.to.flatten(m_dimensions);
     auto p = m_board[src];
@@ -100,13 +283,38 @@ Board::move(Move move)
         assert(false && "piece at destination");
     }
 
+    togglePieceHash(*p);
     p->place(move.to);
+    togglePieceHash(*p);
+    if (m_network)
+    {
+        m_network->movePiece(m_accumulator, p->getType(), move.from, move.to);
+    }
+    if (m_hasPatterns)
+    {
+        setPatternSquare(move.from, Piece::Type::Unset);
+        setPatternSquare(move.to, p->getType());
+    }
     m_board[dst] = p;
     m_board[src] = nullptr;
+    setOccupied(move.from, false);
+    setOccupied(move.to, true);
 
     scanCaptures();
 
     setTurn(!m_turn);
+
+    if (m_searchTree)
+    {
+        if (m_movesSinceSearch.full())
+        {
+            m_searchTree.reset();
+        }
+        else
+        {
+            m_movesSinceSearch.push_back(move);
+        }
+    }
 }
 
 uint64_t
@@ -140,268 +348,1081 @@ Board::getTurn() const
 void
 Board::setTurn(Color which)
 {
+    if (which != m_turn)
+    {
+        m_hash ^= kBlackToMoveKey;
+    }
     m_turn = which;
 }
 
-std::optional<Color>
-Board::getWinner() const
+std::unique_ptr<IBoard>
+Board::clone() const
 {
-    auto itKing = std::find_if(m_pieces.begin(), m_pieces.end(), [](const auto& cur) {
-        return cur->getType() == Piece::Type::King;
-    });
+    return std::unique_ptr<IBoard>(new Board(*this));
+}
 
-    if (itKing == m_pieces.end())
+bool
+Board::setPosition(std::span<const Piece::Type> squares, Color turn)
+{
+    if (squares.size() != m_dimensions * m_dimensions)
     {
-        // The king is gone
-        return Color::Black;
+        return false;
     }
-    const auto dim = getBoardDimension();
-    auto kingPos = (*itKing)->getPosition();
 
-    if (kingPos.x == 0 || kingPos.x == dim - 1 || kingPos.y == 0 || kingPos.y == dim - 1)
+    m_pieces.clear();
+    m_board.fill(nullptr);
+    m_pieceCount.fill(0);
+    m_king = nullptr;
+    m_rowOccupancy.fill(0);
+    m_columnOccupancy.fill(0);
+    m_turn = turn;
+    m_hash = turn == Color::Black ? kBlackToMoveKey : 0;
+    m_searchTree.reset();
+    m_movesSinceSearch.clear();
+
+    for (auto i = 0u; i < squares.size(); i++)
     {
-        return Color::White;
+        if (squares[i] != Piece::Type::Unset)
+        {
+            Piece piece(squares[i]);
+            piece.place({i % m_dimensions, i / m_dimensions});
+            addPiece(piece);
+        }
     }
+    attachNetwork(m_network);
+    attachPatterns(m_hasPatterns);
 
-    return std::nullopt;
+    return true;
 }
 
-std::future<std::optional<Move>>
-Board::calculateBestMove(const std::chrono::milliseconds& quota,
-                         std::function<void()> onFutureReady)
+uint64_t
+Board::hash() const
 {
-    const auto nThreads = 6u;
-
-    auto possibleMoves = getPossibleMoves();
+    return m_hash;
+}
 
-    std::promise<std::optional<Move>> p;
+std::array<uint64_t, Board::kSymmetries>
+Board::symmetricHashes() const
+{
+    std::array<uint64_t, kSymmetries> out;
+    out.fill(m_turn == Color::Black ? kBlackToMoveKey : 0);
 
-    if (possibleMoves.empty())
+    for (auto& piece : m_pieces)
     {
-        p.set_value(std::nullopt);
-        return p.get_future();
-    }
+        auto type = static_cast<unsigned>(piece->getType());
 
-    std::vector<std::future<std::vector<MoveAndResults>>> threadFutures;
-    for (auto thr = 0u; thr < nThreads; thr++)
-    {
-        threadFutures.push_back(runSimulationInThread(quota, possibleMoves));
-    }
-    auto black = m_turn == Color::Black;
+        for (auto s = 0u; s < kSymmetries; s++)
+        {
+            auto square = transform(piece->getPosition(), s, m_dimensions).flatten(m_dimensions);
 
-    const auto number_of_moves = possibleMoves.size();
-    return std::async(
-        std::launch::async,
-        [black, number_of_moves, threadFutures = std::move(threadFutures)]() mutable {
-            std::optional<Move> out;
-            std::vector<MoveAndResults> results;
-            results.resize(number_of_moves);
+            out[s] ^= kZobristKeys[square * 4 + type];
+        }
+    }
 
-            for (auto& f : threadFutures)
-            {
-                f.wait();
-                auto r = f.get();
+    return out;
+}
 
-                for (auto i = 0; i < number_of_moves; i++)
-                {
-                    results[i].move = r[i].move;
-                    // Only care about valid values
-                    if (r[i].results.samples)
-                    {
-                        results[i].results = results[i].results + r[i].results;
-                    }
-                }
-            }
+std::pair<uint64_t, unsigned>
+Board::canonicalHash() const
+{
+    auto hashes = symmetricHashes();
+    auto canonical = std::ranges::min_element(hashes);
 
-            std::ranges::sort(results, [](const MoveAndResults& a, const MoveAndResults& b) {
-                return a.results.blackWins / a.results.whiteWins >
-                       b.results.blackWins / b.results.whiteWins;
-            });
+    return {*canonical, static_cast<unsigned>(canonical - hashes.begin())};
+}
 
-            for (auto x : results)
-            {
-                auto f = x.move.from;
-                auto t = x.move.to;
-
-                fmt::print("{}:{} -> {}:{}, leads to {} black wins ({:.3f}:{:.3f} of {})\n",
-                           f.x,
-                           f.y,
-                           t.x,
-                           t.y,
-                           x.results.blackWins / x.results.whiteWins,
-                           x.results.blackWins,
-                           x.results.whiteWins,
-                           x.results.samples);
-            }
+Pos
+Board::transform(const Pos& pos, unsigned symmetry, unsigned dimension)
+{
+    auto x = pos.x;
+    auto y = pos.y;
 
-            if (black)
-            {
-                out = results.front().move;
-            }
-            else
-            {
-                out = results.back().move;
-            }
+    if (symmetry & 4)
+    {
+        std::swap(x, y);
+    }
+    if (symmetry & 1)
+    {
+        x = dimension - 1 - x;
+    }
+    if (symmetry & 2)
+    {
+        y = dimension - 1 - y;
+    }
 
-            return out;
-        });
+    return {x, y};
 }
 
-void
-Board::scanCaptures()
+Move
+Board::transform(const Move& move, unsigned symmetry, unsigned dimension)
 {
-    etl::vector<unsigned, 18 * 18 / 2> capture_indices;
+    return {transform(move.from, symmetry, dimension), transform(move.to, symmetry, dimension)};
+}
 
-    auto dim = getBoardDimension();
+unsigned
+Board::inverse(unsigned symmetry)
+{
+    // Mirroring the columns after the swap is mirroring the rows before it
+    return symmetry & 4 ? 4 | (symmetry & 1) << 1 | (symmetry & 2) >> 1 : symmetry;
+}
 
-    for (auto index = 0u; index < m_pieces.size(); index++)
+unsigned
+Board::compose(unsigned first, unsigned second)
+{
+    auto mirrors = first & 3;
+    if (second & 4)
     {
-        auto piece = m_pieces[index];
+        // The mirrors of the first are swapped along with the rows and the columns
+        mirrors = (mirrors & 1) << 1 | (mirrors & 2) >> 1;
+    }
 
-        if (piece->getColor() == m_turn)
-        {
-            continue;
-        }
-        const auto pos = piece->getPosition();
+    return ((first ^ second) & 4) | (mirrors ^ (second & 3));
+}
 
-        auto above = pieceColorAt(pos.above());
-        auto below = pieceColorAt(pos.below());
-        auto right = pieceColorAt(pos.right());
-        auto left = pieceColorAt(pos.left());
+void
+Board::togglePieceHash(const Piece& piece)
+{
+    auto square = piece.getPosition().flatten(m_dimensions);
 
-        auto verticalEnemies =
-            above && below && *above != piece->getColor() && *below != piece->getColor();
-        auto horizontalEnemies =
-            left && right && *left != piece->getColor() && *right != piece->getColor();
+    m_hash ^= kZobristKeys[square * 4 + static_cast<unsigned>(piece.getType())];
+}
 
-        if (piece->getType() == Piece::Type::King && pos == Pos {dim / 2, dim / 2})
-        {
-            // The king in the castle - all 4 sides must be occupied
-            if (verticalEnemies && horizontalEnemies)
-            {
-                capture_indices.push_back(index);
-            }
-        }
-        else
-        {
-            if (verticalEnemies || horizontalEnemies)
-            {
-                capture_indices.push_back(index);
-            }
-        }
+bool
+Board::attachNetwork(const NeuralNetwork* network)
+{
+    if (network && network->getParameters().dimension != m_dimensions)
+    {
+        return false;
     }
 
-    for (auto& idx : capture_indices)
+    m_network = network;
+    if (m_network)
     {
-        m_board[m_pieces[idx]->getPosition().flatten(dim)] = nullptr;
+        m_network->refresh(*this, m_accumulator);
     }
 
-    // Iterate in reverse order over the captured indicces
-    for (auto i = capture_indices.size(); i > 0; i--)
+    return true;
+}
+
+std::optional<float>
+Board::getNetworkScore() const
+{
+    if (!m_network)
     {
-        auto toErase = m_pieces.begin() + capture_indices[i - 1];
-        m_pieces.erase(toErase);
+        return std::nullopt;
     }
+
+    return m_network->score(m_accumulator, m_turn);
 }
 
-std::optional<Color>
-Board::pieceColorAt(const Pos& pos) const
+void
+Board::attachPatterns(bool attach)
 {
-    if (pos.x >= m_dimensions || pos.y >= m_dimensions)
+    m_hasPatterns = attach;
+    if (m_hasPatterns)
     {
-        return std::nullopt;
+        m_patterns.fill(0);
+        for (auto& p : m_pieces)
+        {
+            setPatternSquare(p->getPosition(), p->getType());
+        }
     }
+}
 
-    auto p = m_board[pos.flatten(m_dimensions)];
-    if (p)
+std::optional<uint16_t>
+Board::getPattern(const Pos& pos) const
+{
+    if (!m_hasPatterns)
     {
-        return p->getColor();
+        return std::nullopt;
     }
 
-    return std::nullopt;
+    return m_patterns[pos.flatten(m_dimensions)];
 }
 
 void
-Board::fillPossibleMoves()
+Board::setPatternSquare(const Pos& pos, Piece::Type type)
 {
-    m_possibleMoves.uninitialized_resize(0);
+    constexpr std::array<std::pair<int, int>, PlayoutPolicy::kDirections> kSteps {
+        {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
 
-    for (auto& piece : m_pieces)
+    for (auto direction = 0u; direction < PlayoutPolicy::kDirections; direction++)
     {
-        if (piece->getColor() != m_turn)
-        {
-            continue;
-        }
+        auto [dx, dy] = kSteps[direction];
 
-        auto it = m_moveTrait->begin(*this, *piece);
-        while (it)
+        // The squares which see this one at a distance in the direction. Squares off the
+        // board wrap around to large coordinates.
+        for (auto distance = 1; distance <= 2; distance++)
         {
-            m_possibleMoves.push_back(it->move);
-            it = m_moveTrait->next(*it, *this, *piece);
+            auto x = pos.x - dx * distance;
+            auto y = pos.y - dy * distance;
+            if (x >= m_dimensions || y >= m_dimensions)
+            {
+                break;
+            }
+
+            auto shift = PlayoutPolicy::shift(direction, distance);
+            auto& pattern = m_patterns[y * m_dimensions + x];
+            pattern = static_cast<uint16_t>((pattern & ~(3u << shift)) |
+                                            PlayoutPolicy::code(type) << shift);
         }
     }
 }
 
-std::vector<Move>
-Board::getPossibleMoves() const
+std::optional<Color>
+Board::getWinner() const
 {
-    std::vector<Move> possibleMoves;
+    TAFL_TRACE_SCOPE(GetWinner);
 
-    for (auto& piece : m_pieces)
+    if (!m_king)
     {
-        if (piece->getColor() != m_turn)
-        {
+        // The king is gone
+        return Color::Black;
+    }
+    const auto dim = getBoardDimension();
+    auto kingPos = m_king->getPosition();
+
+    if (kingPos.x == 0 || kingPos.x == dim - 1 || kingPos.y == 0 || kingPos.y == dim - 1)
+    {
+        return Color::White;
+    }
+
+    return std::nullopt;
+}
+
+std::future<std::optional<Move>>
+Board::calculateBestMove(const std::chrono::milliseconds& quota,
+                         std::function<void()> onFutureReady)
+{
+    SearchConfig config;
+    config.quota = quota;
+
+    auto search = this->search(config);
+
+    return std::async(std::launch::async, [search = std::move(search)]() mutable {
+        auto result = search.get();
+
+        for (auto& x : result.moves)
+        {
+            auto f = x.move.from;
+            auto t = x.move.to;
+
+            fmt::print(
+                "{}:{} -> {}:{}, wins {:.3f} of {}\n", f.x, f.y, t.x, t.y, x.winRate, x.visits);
+        }
+        fmt::print("{} playouts in {} ms, {} reused\n",
+                   result.playouts,
+                   result.elapsed.count(),
+                   result.reusedVisits);
+
+        return result.bestMove;
+    });
+}
+
+std::future<SearchResult>
+Board::search(const SearchConfig& config)
+{
+    std::promise<SearchResult> p;
+
+    if (!getRandomMove(0))
+    {
+        // No possible moves
+        p.set_value(SearchResult {});
+        return p.get_future();
+    }
+
+    if (config.seed)
+    {
+        return searchSeeded(config);
+    }
+
+    auto tree = takeSearchTree(config.memoryLimit);
+    if (!tree)
+    {
+        p.set_value(SearchResult {});
+        return p.get_future();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = config.playouts ? std::chrono::steady_clock::time_point::max()
+                                    : start + config.quota;
+    auto reusedVisits = tree->getRootVisits();
+    auto recycles = tree->getRecycleCount();
+    auto transpositions = tree->getTranspositionCount();
+
+    // The workers are always finished before the tree is released below
+    const auto threads = std::max(config.threads, 1u);
+    std::stop_source stop;
+    std::vector<std::future<uint64_t>> threadFutures;
+    for (auto thr = 0u; thr < threads; thr++)
+    {
+        auto playouts = playoutShare(config.playouts, thr, threads);
+
+        threadFutures.push_back(std::async(
+            std::launch::async,
+            [tree = tree.get(),
+             deadline,
+             playouts,
+             evaluation = config.evaluation,
+             network = config.network,
+             playoutDepth = config.playoutDepth,
+             patternPlayouts = config.patternPlayouts,
+             stop = stop.get_token()]() {
+                auto memory = acquireThreadMemory();
+                memory->evaluation = evaluation.get();
+                memory->network = network.get();
+                memory->playoutDepth = playoutDepth;
+                memory->patternPlayouts = patternPlayouts;
+
+                return tree->run(deadline, playouts, *memory, stop);
+            }));
+    }
+
+    auto collect = [tree,
+                    config,
+                    start,
+                    reusedVisits,
+                    recycles,
+                    transpositions,
+                    stop,
+                    threadFutures = std::move(threadFutures)]() mutable {
+        SearchResult out;
+
+        reportProgress(config, start, {tree}, reusedVisits, threadFutures, stop);
+        for (auto& f : threadFutures)
+        {
+            out.playouts += f.get();
+        }
+        out.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        out.moves = tree->getRootStatistics();
+        out.recycles = tree->getRecycleCount() - recycles;
+        out.transpositions = tree->getTranspositionCount() - transpositions;
+        out.reusedVisits = reusedVisits;
+        if (!out.moves.empty())
+        {
+            out.bestMove = out.moves.front().move;
+        }
+
+        // Leave the tree to the board for the next search
+        tree.reset();
+
+        return out;
+    };
+
+    return std::async(std::launch::async, std::move(collect));
+}
+
+std::future<SearchResult>
+Board::searchSeeded(const SearchConfig& config)
+{
+    const auto threads = std::max(config.threads, 1u);
+
+    // Each thread searches a new tree of its own, so nothing depends on the timing
+    std::vector<std::shared_ptr<SearchTree>> trees;
+    for (auto thr = 0u; thr < threads; thr++)
+    {
+        trees.push_back(SearchTree::create(*this, config.memoryLimit / threads));
+        if (!trees.back())
+        {
+            std::promise<SearchResult> p;
+
+            p.set_value(SearchResult {});
+            return p.get_future();
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = config.playouts ? std::chrono::steady_clock::time_point::max()
+                                    : start + config.quota;
+    std::stop_source stop;
+    std::vector<std::future<uint64_t>> threadFutures;
+    auto seed = *config.seed;
+    for (auto thr = 0u; thr < threads; thr++)
+    {
+        auto playouts = playoutShare(config.playouts, thr, threads);
+        auto random = splitMix64(seed);
+
+        threadFutures.push_back(std::async(
+            std::launch::async,
+            [tree = trees[thr].get(),
+             deadline,
+             playouts,
+             random,
+             evaluation = config.evaluation,
+             network = config.network,
+             playoutDepth = config.playoutDepth,
+             patternPlayouts = config.patternPlayouts,
+             stop = stop.get_token()]() {
+                auto memory = acquireThreadMemory();
+                memory->random = random;
+                memory->evaluation = evaluation.get();
+                memory->network = network.get();
+                memory->playoutDepth = playoutDepth;
+                memory->patternPlayouts = patternPlayouts;
+
+                return tree->run(deadline, playouts, *memory, stop);
+            }));
+    }
+
+    auto collect = [trees = std::move(trees),
+                    config,
+                    start,
+                    stop,
+                    threadFutures = std::move(threadFutures)]() mutable {
+        SearchResult out;
+
+        reportProgress(config, start, trees, 0, threadFutures, stop);
+
+        for (auto thr = 0u; thr < trees.size(); thr++)
+        {
+            out.playouts += threadFutures[thr].get();
+            out.recycles += trees[thr]->getRecycleCount();
+            out.transpositions += trees[thr]->getTranspositionCount();
+        }
+        out.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        out.moves = SearchTree::mergeRootStatistics(trees);
+        if (!out.moves.empty())
+        {
+            out.bestMove = out.moves.front().move;
+        }
+
+        return out;
+    };
+
+    return std::async(std::launch::async, std::move(collect));
+}
+
+ProofResult
+Board::prove(const ProofConfig& config) const
+{
+    return ProofNumberSearch(config).run(*this);
+}
+
+std::optional<TablebaseResult>
+Board::probeTablebase() const
+{
+    if (TablebaseFile::loaded().empty() || !m_king)
+    {
+        return std::nullopt;
+    }
+
+    auto whites = m_pieceCount[static_cast<unsigned>(Color::White)] - 1;
+    auto blacks = m_pieceCount[static_cast<unsigned>(Color::Black)];
+    auto tablebase = TablebaseFile::find(m_dimensions, whites, blacks);
+    if (!tablebase)
+    {
+        return std::nullopt;
+    }
+
+    TablebasePosition position;
+    position.turn = m_turn;
+    for (auto& piece : m_pieces)
+    {
+        auto square = piece->getPosition().flatten(m_dimensions);
+
+        switch (piece->getType())
+        {
+        case Piece::Type::King:
+            position.king = square;
+            break;
+        case Piece::Type::White:
+            position.whites |= uint64_t(1) << square;
+            break;
+        case Piece::Type::Black:
+            position.blacks |= uint64_t(1) << square;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return tablebase->probe(position);
+}
+
+std::shared_ptr<SearchTree>
+Board::takeSearchTree(size_t memoryLimit)
+{
+    auto tree = std::move(m_searchTree);
+    auto moves = std::span<const Move>(m_movesSinceSearch.data(), m_movesSinceSearch.size());
+
+    // Not if another search still runs on it, or if the position was changed otherwise
+    if (!tree || tree.use_count() > 1 || tree->getMemoryLimit() != memoryLimit ||
+        !tree->advance(moves) || tree->getRoot().hash() != hash())
+    {
+        // Return the memory of the old tree to the pool first, for the new one
+        tree.reset();
+        tree = SearchTree::create(*this, memoryLimit);
+    }
+    m_searchTree = tree;
+    m_movesSinceSearch.clear();
+
+    return tree;
+}
+
+void
+Board::scanCaptures()
+{
+    TAFL_TRACE_SCOPE(ScanCaptures);
+
+    etl::vector<unsigned, 18 * 18 / 2> capture_indices;
+
+    auto dim = getBoardDimension();
+
+    for (auto index = 0u; index < m_pieces.size(); index++)
+    {
+        auto piece = m_pieces[index];
+
+        if (piece->getColor() == m_turn)
+        {
+            continue;
+        }
+        const auto pos = piece->getPosition();
+
+        auto above = pieceColorAt(pos.above());
+        auto below = pieceColorAt(pos.below());
+        auto right = pieceColorAt(pos.right());
+        auto left = pieceColorAt(pos.left());
+
+        auto verticalEnemies =
+            above && below && *above != piece->getColor() && *below != piece->getColor();
+        auto horizontalEnemies =
+            left && right && *left != piece->getColor() && *right != piece->getColor();
+
+        if (piece->getType() == Piece::Type::King && pos == Pos {dim / 2, dim / 2})
+        {
+            // The king in the castle - all 4 sides must be occupied
+            if (verticalEnemies && horizontalEnemies)
+            {
+                capture_indices.push_back(index);
+            }
+        }
+        else
+        {
+            if (verticalEnemies || horizontalEnemies)
+            {
+                capture_indices.push_back(index);
+            }
+        }
+    }
+
+    for (auto& idx : capture_indices)
+    {
+        auto piece = m_pieces[idx];
+
+        m_board[piece->getPosition().flatten(dim)] = nullptr;
+        setOccupied(piece->getPosition(), false);
+        m_pieceCount[static_cast<unsigned>(piece->getColor())]--;
+        togglePieceHash(*piece);
+        if (m_network)
+        {
+            m_network->removePiece(m_accumulator, piece->getType(), piece->getPosition());
+        }
+        if (m_hasPatterns)
+        {
+            setPatternSquare(piece->getPosition(), Piece::Type::Unset);
+        }
+        if (piece == m_king)
+        {
+            m_king = nullptr;
+        }
+    }
+
+    TAFL_TRACE_COUNT(Captures, capture_indices.size());
+
+    // Iterate in reverse order over the captured indicces
+    for (auto i = capture_indices.size(); i > 0; i--)
+    {
+        auto toErase = m_pieces.begin() + capture_indices[i - 1];
+        m_pieces.erase(toErase);
+    }
+}
+
+std::optional<Color>
+Board::pieceColorAt(const Pos& pos) const
+{
+    if (pos.x >= m_dimensions || pos.y >= m_dimensions)
+    {
+        return std::nullopt;
+    }
+
+    auto p = m_board[pos.flatten(m_dimensions)];
+    if (p)
+    {
+        return p->getColor();
+    }
+
+    return std::nullopt;
+}
+
+void
+Board::setOccupied(const Pos& pos, bool occupied)
+{
+    if (occupied)
+    {
+        m_rowOccupancy[pos.y] |= 1u << pos.x;
+        m_columnOccupancy[pos.x] |= 1u << pos.y;
+    }
+    else
+    {
+        m_rowOccupancy[pos.y] &= ~(1u << pos.x);
+        m_columnOccupancy[pos.x] &= ~(1u << pos.y);
+    }
+}
+
+std::pair<uint32_t, uint32_t>
+Board::reachableSquares(const Pos& pos) const
+{
+    const auto center = m_dimensions / 2;
+    const auto castle = 1u << center;
+    const auto stride = 1u << m_dimensions;
+
+    // Nothing can move to or pass the castle, so treat it as occupied
+    auto row = m_rowOccupancy[pos.y] | (pos.y == center ? castle : 0);
+    auto column = m_columnOccupancy[pos.x] | (pos.x == center ? castle : 0);
+
+    if (m_slidingMoves.empty())
+    {
+        auto slide = [this](unsigned at, uint32_t occupancy) {
+            uint32_t out = 0;
+
+            for (auto i = at + 1; i < m_dimensions && !(occupancy & (1u << i)); i++)
+            {
+                out |= 1u << i;
+            }
+            for (auto i = at; i > 0 && !(occupancy & (1u << (i - 1))); i--)
+            {
+                out |= 1u << (i - 1);
+            }
+
+            return out;
+        };
+
+        return {slide(pos.x, row), slide(pos.y, column)};
+    }
+
+    return {m_slidingMoves[pos.x * stride + row], m_slidingMoves[pos.y * stride + column]};
+}
+
+Board::KingEscapes
+Board::findKingEscapes() const
+{
+    KingEscapes out;
+
+    if (!m_king)
+    {
+        return out;
+    }
+
+    const auto king = m_king->getPosition();
+    const auto last = m_dimensions - 1;
+    auto [row, column] = reachableSquares(king);
+
+    // An open line reaches the edge, and covers the squares between the king and the edge
+    if (row & 1u)
+    {
+        out.row |= (1u << king.x) - 1;
+        out.lines++;
+    }
+    if (row & (1u << last))
+    {
+        out.row |= row & ~((1u << king.x) - 1);
+        out.lines++;
+    }
+    if (column & 1u)
+    {
+        out.column |= (1u << king.y) - 1;
+        out.lines++;
+    }
+    if (column & (1u << last))
+    {
+        out.column |= column & ~((1u << king.y) - 1);
+        out.lines++;
+    }
+
+    return out;
+}
+
+std::span<Move>
+Board::getKingEscapes(std::span<Move> out) const
+{
+    auto n = 0u;
+    auto escapes = findKingEscapes();
+
+    if (escapes.lines == 0)
+    {
+        return out.first(0);
+    }
+
+    const auto king = m_king->getPosition();
+    const auto last = m_dimensions - 1;
+    for (auto to : {Pos {0, king.y}, Pos {last, king.y}})
+    {
+        if (n < out.size() && (escapes.row & (1u << to.x)))
+        {
+            out[n++] = {king, to};
+        }
+    }
+    for (auto to : {Pos {king.x, 0}, Pos {king.x, last}})
+    {
+        if (n < out.size() && (escapes.column & (1u << to.y)))
+        {
+            out[n++] = {king, to};
+        }
+    }
+
+    return out.first(n);
+}
+
+bool
+Board::capturesKing(const Move& move) const
+{
+    const auto king = m_king->getPosition();
+    const auto dim = getBoardDimension();
+
+    auto hostile = [this, &move](const Pos& pos) {
+        if (pos == move.to)
+        {
+            return true;
+        }
+        if (pos == move.from)
+        {
+            return false;
+        }
+
+        return pieceColorAt(pos) == Color::Black;
+    };
+
+    auto vertical = hostile(king.above()) && hostile(king.below());
+    auto horizontal = hostile(king.left()) && hostile(king.right());
+
+    if (king == Pos {dim / 2, dim / 2})
+    {
+        return vertical && horizontal;
+    }
+
+    return vertical || horizontal;
+}
+
+std::optional<Move>
+Board::getBlockingMove(uint32_t random) const
+{
+    if (m_turn != Color::Black || !m_king)
+    {
+        return std::nullopt;
+    }
+
+    return selectBlockingMove(findKingEscapes(), random);
+}
+
+std::optional<Move>
+Board::selectBlockingMove(const KingEscapes& escapes, uint32_t random) const
+{
+    std::optional<Move> out;
+    auto n = 0u;
+    uint64_t state = random;
+
+    // One move can only block one line, but a capture of the king stops all of them
+    generateMoves([this, &escapes, &out, &n, &state](const Move& move) {
+        const auto king = m_king->getPosition();
+        auto blocks = escapes.lines == 1 &&
+                      ((move.to.y == king.y && (escapes.row & (1u << move.to.x))) ||
+                       (move.to.x == king.x && (escapes.column & (1u << move.to.y))));
+
+        if (!blocks && !capturesKing(move))
+        {
+            return;
+        }
+
+        // Reservoir sampling, to select uniformly among the candidates: keep the nth
+        // with a chance of 1 / n, by reducing a 32-bit random number to [0, n)
+        n++;
+        if (((splitMix64(state) >> 32) * n) >> 32 == 0)
+        {
+            out = move;
+        }
+    });
+
+    return out;
+}
+
+template <typename F>
+void
+Board::generateMoves(F&& onMove) const
+{
+    TAFL_TRACE_SCOPE(MoveGeneration);
+
+    for (auto& piece : m_pieces)
+    {
+        if (piece->getColor() != m_turn)
+        {
+            continue;
+        }
+
+        if (!m_slidingMoves.empty())
+        {
+            const auto from = piece->getPosition();
+            auto [row, column] = reachableSquares(from);
+
+            for (; row; row &= row - 1)
+            {
+                onMove(Move {from, {static_cast<unsigned>(std::countr_zero(row)), from.y}});
+            }
+            for (; column; column &= column - 1)
+            {
+                onMove(Move {from, {from.x, static_cast<unsigned>(std::countr_zero(column))}});
+            }
             continue;
         }
 
         auto it = m_moveTrait->begin(*this, *piece);
         while (it)
         {
-            possibleMoves.push_back(it->move);
+            onMove(it->move);
             it = m_moveTrait->next(*it, *this, *piece);
         }
     }
+}
+
+std::vector<Move>
+Board::getPossibleMoves() const
+{
+    std::vector<Move> possibleMoves;
+
+    generateMoves([&possibleMoves](const Move& move) { possibleMoves.push_back(move); });
 
     return possibleMoves;
 }
 
-std::future<std::vector<Board::MoveAndResults>>
-Board::runSimulationInThread(const std::chrono::milliseconds& quota,
-                             std::span<const Move> movesToSimulate)
+std::span<Move>
+Board::getPossibleMoves(std::span<Move> out) const
 {
-    auto bIn = Board(*this);
+    auto n = 0u;
 
-    auto moves = std::vector<Move>(movesToSimulate.begin(), movesToSimulate.end());
+    generateMoves([&out, &n](const Move& move) {
+        if (n < out.size())
+        {
+            out[n++] = move;
+        }
+    });
 
-    return std::async(std::launch::async, [bIn, moves, quota] {
-        // Create an output vector
-        auto known_boards = std::make_unique<TaflBoardHashTable>();
-        auto out = std::vector<Board::MoveAndResults>();
-        out.reserve(moves.size());
+    return out.first(n);
+}
 
-        auto v = std::views::transform(
-            moves, [](auto&& move) { return Board::MoveAndResults {move, Board::PlayResult()}; });
-        std::ranges::copy(v, std::back_inserter(out));
+std::optional<Move>
+Board::getRandomMove(uint32_t random) const
+{
+    TAFL_TRACE_SCOPE(RandomMove);
 
-        auto start = std::chrono::steady_clock::now();
-        while (std::chrono::steady_clock::now() - start < quota)
+    if (m_slidingMoves.empty())
+    {
+        auto n = 0u;
+        std::optional<Move> out;
+
+        generateMoves([&n](const Move&) { n++; });
+        if (n)
         {
-            for (auto& cur : out)
-            {
-                auto b = bIn;
-                b.move(cur.move);
-                cur.results = cur.results + b.simulate(*known_boards, 5);
-            }
+            auto selected = random % n;
+
+            generateMoves([&out, &selected](const Move& move) {
+                if (selected-- == 0)
+                {
+                    out = move;
+                }
+            });
         }
 
         return out;
-    });
+    }
+
+    // Count the moves per piece instead of generating them
+    std::array<uint8_t, 18 * 18> mobility;
+    auto n = 0u;
+
+    for (auto i = 0u; i < m_pieces.size(); i++)
+    {
+        auto piece = m_pieces[i];
+
+        mobility[i] = 0;
+        if (piece->getColor() == m_turn)
+        {
+            auto [row, column] = reachableSquares(piece->getPosition());
+
+            mobility[i] = std::popcount(row) + std::popcount(column);
+            n += mobility[i];
+        }
+    }
+
+    if (n == 0)
+    {
+        return std::nullopt;
+    }
+
+    auto selected = random % n;
+    auto i = 0u;
+    while (selected >= mobility[i])
+    {
+        selected -= mobility[i];
+        i++;
+    }
+
+    const auto from = m_pieces[i]->getPosition();
+    auto [row, column] = reachableSquares(from);
+    auto rowMoves = static_cast<unsigned>(std::popcount(row));
+
+    if (selected < rowMoves)
+    {
+        return Move {from, {nthSetBit(row, selected), from.y}};
+    }
+
+    return Move {from, {from.x, nthSetBit(column, selected - rowMoves)}};
+}
+
+std::optional<Move>
+Board::selectPlayoutMove(ThreadMemory& memory) const
+{
+    TAFL_TRACE_SCOPE(RandomMove);
+
+    // Enough for the weights to matter, after which the last move drawn is taken
+    constexpr auto kMaxDraws = 16u;
+    // A bound on the time, after which a uniform move is taken
+    constexpr auto kMaxTries = 256u;
+
+    if (m_pieces.empty())
+    {
+        return std::nullopt;
+    }
+
+    /*
+     * A piece, then a square in its row or its column, each as likely, which is a move if
+     * it's the side to move's and the square is reachable. The possible moves are then
+     * drawn uniformly without listing them, and each try takes constant time.
+     */
+    std::optional<Move> out;
+    auto draws = 0u;
+    for (auto tries = 0u; tries < kMaxTries && draws < kMaxDraws; tries++)
+    {
+        // The high bits of the random number take the piece, the low bits the square
+        auto random = memory.nextRandom();
+        auto piece = m_pieces[((random >> 16) * m_pieces.size()) >> 16];
+        if (piece->getColor() != m_turn)
+        {
+            continue;
+        }
+
+        const auto from = piece->getPosition();
+        auto vertical = (random >> 15 & 1) != 0;
+        auto at = ((random & 0x7fff) * m_dimensions) >> 15;
+        auto [row, column] = reachableSquares(from);
+        if (!((vertical ? column : row) >> at & 1))
+        {
+            continue;
+        }
+
+        out = vertical ? Move {from, {from.x, at}} : Move {from, {at, from.y}};
+        draws++;
+
+        // Kept with a chance of its weight
+        auto pattern = PlayoutPolicy::afterMove(m_patterns[out->to.flatten(m_dimensions)], *out);
+        if ((memory.nextRandom() & 0xff) < PlayoutPolicy::weight(m_turn, pattern))
+        {
+            break;
+        }
+    }
+
+    if (!out)
+    {
+        return getRandomMove(memory.nextRandom());
+    }
+
+    return out;
+}
+
+void
+Board::visitPossibleMoves(Visitor<Move> visitor, void* context) const
+{
+    generateMoves([visitor, context](const Move& move) { visitor(context, move); });
+}
+
+namespace
+{
+
+std::mutex g_threadMemoryMutex;
+
+} // namespace
+
+Board::ThreadMemory::ThreadMemory()
+    : random(static_cast<uint64_t>(std::random_device {}()) << 32 | std::random_device {}())
+{
+}
+
+uint32_t
+Board::ThreadMemory::nextRandom()
+{
+    return static_cast<uint32_t>(splitMix64(random) >> 32);
+}
+
+void
+Board::ThreadMemoryReleaser::operator()(ThreadMemory* memory) const
+{
+    std::lock_guard lock(g_threadMemoryMutex);
+
+    threadMemoryPool().emplace_back(memory);
+}
+
+std::vector<std::unique_ptr<Board::ThreadMemory>>&
+Board::threadMemoryPool()
+{
+    static std::vector<std::unique_ptr<ThreadMemory>> pool;
+
+    return pool;
+}
+
+Board::ThreadMemoryLease
+Board::acquireThreadMemory()
+{
+    std::unique_ptr<ThreadMemory> memory;
+
+    {
+        std::lock_guard lock(g_threadMemoryMutex);
+
+        if (!threadMemoryPool().empty())
+        {
+            memory = std::move(threadMemoryPool().back());
+            threadMemoryPool().pop_back();
+        }
+    }
+
+    if (!memory)
+    {
+        memory = std::make_unique<ThreadMemory>();
+    }
+
+    return ThreadMemoryLease(memory.release());
 }
 
 Board::PlayResult
-Board::simulate(TaflBoardHashTable& known_boards, unsigned ply)
+Board::simulate(ThreadMemory& memory, unsigned ply)
 {
-    while (true)
+    TAFL_TRACE_SCOPE(Playout);
+
+    // Networks of another dimension are skipped
+    auto network = memory.network;
+    if (network && network->getParameters().dimension != m_dimensions)
+    {
+        network = nullptr;
+    }
+    if (network != m_network)
+    {
+        attachNetwork(network);
+    }
+    if (memory.patternPlayouts != m_hasPatterns)
+    {
+        attachPatterns(memory.patternPlayouts);
+    }
+
+    for (auto moves = 0u;; moves++)
     {
         auto winner = getWinner();
 
@@ -410,17 +1431,61 @@ Board::simulate(TaflBoardHashTable& known_boards, unsigned ply)
             return Board::PlayResult(*winner, ply);
         }
 
-        fillPossibleMoves();
-        if (m_possibleMoves.empty())
+        if (auto known = probeTablebase())
+        {
+            return Board::PlayResult(known->winner, ply + known->plies);
+        }
+
+        if ((network || memory.evaluation) && moves >= memory.playoutDepth)
+        {
+            float white;
+            if (network)
+            {
+                // The accumulator was updated move by move, as if it was refreshed now
+                white = network->winRate(m_accumulator, m_turn, Color::White);
+            }
+            else
+            {
+                white = memory.evaluation->winRate(*this, Color::White);
+            }
+
+            return Board::PlayResult(white / ply, (1 - white) / ply, 1);
+        }
+
+        std::optional<Move> m;
+        auto escapes = findKingEscapes();
+
+        if (escapes.lines != 0)
+        {
+            if (m_turn == Color::White)
+            {
+                // The king escapes with the next move
+                return Board::PlayResult(Color::White, ply + 1);
+            }
+
+            m = selectBlockingMove(escapes, memory.nextRandom());
+            if (!m)
+            {
+                // Black can't stop the king from escaping
+                return Board::PlayResult(Color::White, ply + 2);
+            }
+        }
+        else if (m_hasPatterns)
+        {
+            m = selectPlayoutMove(memory);
+        }
+        else
+        {
+            m = getRandomMove(memory.nextRandom());
+        }
+
+        if (!m)
         {
             // Impossible, but anyway
             return Board::PlayResult();
         }
 
-        auto selected = rand() % m_possibleMoves.size();
-
-        auto m = m_possibleMoves[selected];
-        move(m);
+        move(*m);
 
         ply++;
     }
@@ -437,34 +1502,25 @@ IBoard::fromString(const std::string_view& s)
     }
 
 
-    auto d = ::sqrt(s.size());
-    auto f = ::floor(d);
+    auto dimension = 1u;
+    while (dimension * dimension < s.size())
+    {
+        dimension++;
+    }
 
-    if (f != d)
+    // Must be square, e.g., 9 * 9, 11 * 11 etc, and fit the board storage
+    if (dimension * dimension != s.size() || dimension > 18)
     {
-        // Must be square, e.g., 9 * 9, 11 * 11 etc
         return nullptr;
     }
 
-    auto dimension = static_cast<unsigned>(f);
-
-    std::vector<std::unique_ptr<Piece>> pieces;
-
-    for (auto i = 0u; i < dimension * dimension; i++)
+    std::array<Piece::Type, 18 * 18> squares;
+    for (auto i = 0u; i < s.size(); i++)
     {
-        auto x = i % dimension;
-        auto y = i / dimension;
-        auto c = s[i];
-
-        auto p = Piece::fromChar(c);
-        if (p)
-        {
-            p->place({x, y});
-            pieces.push_back(std::move(p));
-        }
+        squares[i] = Piece::typeFromChar(s[i]).value_or(Piece::Type::Unset);
     }
 
-    return std::make_unique<Board>(dimension, pieces);
+    return std::make_unique<Board>(dimension, std::span(squares.data(), s.size()), Color::White);
 }
 
 void
@@ -499,16 +1555,16 @@ IBoard::printBoard(const IBoard& board)
     constexpr auto black_at_start = 16;
     constexpr auto white_at_start = 9;
 
-    auto black = board.getPieces(Color::Black);
-    auto white = board.getPieces(Color::White);
+    auto black = board.getPieceCount(Color::Black);
+    auto white = board.getPieceCount(Color::White);
 
     fmt::print("\n\nTaken pieces: ");
-    for (auto i = 0u; i < black_at_start - black.size(); i++)
+    for (auto i = black; i < black_at_start; i++)
     {
         fmt::print("b");
     }
     fmt::print(" ");
-    for (auto i = 0u; i < white_at_start - white.size(); i++)
+    for (auto i = white; i < white_at_start; i++)
     {
         fmt::print("w");
     }
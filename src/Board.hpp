@@ -1,19 +1,26 @@
 #pragma once
 
-#include <BoardHashTable.hpp>
 #include <IBoard.hpp>
 #include <IMoveTrait.hpp>
+#include <NeuralNetwork.hpp>
+#include <SearchConfig.hpp>
+#include <SlidingMoveTable.hpp>
 #include <array>
 #include <etl/vector.h>
+#include <memory>
 #include <span>
+#include <utility>
 
 namespace tafl
 {
 
+class SearchTree;
+
 class Board : public IBoard
 {
 public:
-    Board(unsigned dimensions, std::vector<std::unique_ptr<Piece>>& pieces);
+    // The piece types are for each square, row by row
+    Board(unsigned dimensions, std::span<const Piece::Type> squares, Color turn);
 
     unsigned getBoardDimension() const override;
 
@@ -21,22 +28,69 @@ public:
 
     std::vector<Piece> getPieces(const Color& which) const override;
 
+    std::span<Piece> getPieces(const Color& which, std::span<Piece> out) const override;
+
     std::vector<Move> getPossibleMoves() const override;
 
+    std::span<Move> getPossibleMoves(std::span<Move> out) const override;
+
+    std::optional<Move> getRandomMove(uint32_t random) const override;
+
+    std::span<Move> getKingEscapes(std::span<Move> out) const override;
+
+    std::optional<Move> getBlockingMove(uint32_t random) const override;
+
+    unsigned getPieceCount(const Color& which) const override;
+
+    std::optional<Pos> getKingPosition() const override;
+
     void move(Move move) override;
 
     Color getTurn() const override;
 
     void setTurn(Color which) override;
 
+    std::unique_ptr<IBoard> clone() const override;
+
+    bool setPosition(std::span<const Piece::Type> squares, Color turn) override;
+
+    bool attachNetwork(const NeuralNetwork* network) override;
+
+    std::optional<float> getNetworkScore() const override;
+
+    void attachPatterns(bool attach) override;
+
+    std::optional<uint16_t> getPattern(const Pos& pos) const override;
+
     std::optional<Color> getWinner() const override;
 
     std::future<std::optional<Move>>
     calculateBestMove(const std::chrono::milliseconds& quota,
                       std::function<void()> onFutureReady) override;
 
+    std::future<SearchResult> search(const SearchConfig& config) override;
+
+    ProofResult prove(const ProofConfig& config) const override;
+
+    std::optional<TablebaseResult> probeTablebase() const override;
+
+protected:
+    void visitPieces(const Color& which, Visitor<Piece> visitor, void* context) const override;
+
+    void visitPossibleMoves(Visitor<Move> visitor, void* context) const override;
+
 private:
-    using TaflBoardHashTable = BoardHashTable<1024*1024>;
+    friend class ProofNumberSearch;
+    friend class SearchTree;
+
+    // The search tree is dropped if more moves than this are played between searches
+    static constexpr auto kMaxMovesSinceSearch = 8u;
+
+    /*
+     * The rotations and mirrors of the board. Bit 2 swaps the rows and the columns, then
+     * bits 0 and 1 mirror the columns and the rows.
+     */
+    static constexpr auto kSymmetries = 8u;
 
     struct PlayResult
     {
@@ -71,45 +125,169 @@ private:
             return PlayResult {
                 whiteWins + other.whiteWins, blackWins + other.blackWins, samples + other.samples};
         }
+
+        // The (ply-weighted) share of wins for a color, 0.5 if there are none
+        float winRate(Color which) const
+        {
+            auto total = whiteWins + blackWins;
+
+            if (total == 0)
+            {
+                return 0.5f;
+            }
+
+            return (which == Color::White ? whiteWins : blackWins) / total;
+        }
+    };
+
+    // The playout state of one thread, allocated once and kept between searches
+    struct ThreadMemory
+    {
+        ThreadMemory();
+
+        // The next random number for the playouts of the thread
+        uint32_t nextRandom();
+
+        // Seeded randomly, or from SearchConfig::seed
+        uint64_t random;
+        // From SearchConfig, for the playouts of the current search
+        const Evaluation* evaluation {nullptr};
+        const NeuralNetwork* network {nullptr};
+        unsigned playoutDepth {0};
+        bool patternPlayouts {false};
     };
 
-    struct MoveAndResults
+    // Returns the memory to the pool when the lease is destroyed
+    struct ThreadMemoryReleaser
     {
-        Move move;
-        PlayResult results;
+        void operator()(ThreadMemory* memory) const;
+    };
+
+    using ThreadMemoryLease = std::unique_ptr<ThreadMemory, ThreadMemoryReleaser>;
+
+    // The open lines from the king to the edges
+    struct KingEscapes
+    {
+        unsigned lines {0};
+        // The squares on the open lines, along the king row and column
+        uint32_t row {0};
+        uint32_t column {0};
     };
 
     Board(const Board&);
 
-    void scanCaptures();
+    void addPiece(const Piece& piece);
 
-    void fillPossibleMoves();
+    void scanCaptures();
 
     std::optional<Color> pieceColorAt(const Pos& pos) const;
 
-    std::future<std::vector<MoveAndResults>>
-    runSimulationInThread(const std::chrono::milliseconds& quota,
-                          std::span<const Move> movesToSimulate);
+    void setOccupied(const Pos& pos, bool occupied);
+
+    // Bitmasks of the squares reachable from pos along its row and column
+    std::pair<uint32_t, uint32_t> reachableSquares(const Pos& pos) const;
+
+    template <typename F>
+    void generateMoves(F&& onMove) const;
+
+    KingEscapes findKingEscapes() const;
+
+    // Would black moving to @a to capture the king?
+    bool capturesKing(const Move& move) const;
+
+    /*
+     * Select a move for black which captures the king or blocks its escape, or
+     * std::nullopt if there is none.
+     */
+    std::optional<Move> selectBlockingMove(const KingEscapes& escapes, uint32_t random) const;
+
+    /*
+     * Select a move for a playout by the patterns of PlayoutPolicy. Moves are drawn
+     * uniformly, from a piece and a square without listing the moves, and kept with a
+     * chance of their weight, so that each draw takes constant time.
+     */
+    std::optional<Move> selectPlayoutMove(ThreadMemory& memory) const;
+
+    static ThreadMemoryLease acquireThreadMemory();
+
+    /*
+     * The tree from the last search, advanced to this position, or a new tree if it
+     * can't be reused. nullptr if the memory for a new tree can't be allocated.
+     */
+    std::shared_ptr<SearchTree> takeSearchTree(size_t memoryLimit);
+
+    // Search with a tree per thread, as in SearchConfig::seed
+    std::future<SearchResult> searchSeeded(const SearchConfig& config);
+
+    static std::vector<std::unique_ptr<ThreadMemory>>& threadMemoryPool();
 
     /*
-     * Run random moves until a winner is found.
+     * Run random moves until a winner is found, or score the position with the network
+     * or the evaluation of the memory after its playout depth. Escapes for the king are
+     * always taken and blocked if possible.
      */
-    PlayResult simulate(TaflBoardHashTable &known_boards, unsigned ply);
+    PlayResult simulate(ThreadMemory& memory, unsigned ply);
 
     uint64_t checksum() const;
 
+    // The Zobrist hash of the position, including the side to move
+    uint64_t hash() const;
+
+    // The Zobrist hashes of the position under each symmetry, the first being hash()
+    std::array<uint64_t, kSymmetries> symmetricHashes() const;
+
+    /*
+     * The hash which is the same for all the symmetric positions, and the symmetry
+     * which transforms this position into the canonical one.
+     */
+    std::pair<uint64_t, unsigned> canonicalHash() const;
+
+    // Rotate or mirror a square, as in symmetricHashes()
+    static Pos transform(const Pos& pos, unsigned symmetry, unsigned dimension);
+
+    static Move transform(const Move& move, unsigned symmetry, unsigned dimension);
+
+    // The symmetry which reverts a symmetry
+    static unsigned inverse(unsigned symmetry);
+
+    // The symmetry which transforms as @a first and then @a second
+    static unsigned compose(unsigned first, unsigned second);
+
+    void togglePieceHash(const Piece& piece);
+
+    // Update the patterns which see a square, for the piece type now on it
+    void setPatternSquare(const Pos& pos, Piece::Type type);
+
     uint64_t pieceChecksum(const Piece& piece) const;
 
     const unsigned m_dimensions;
     Color m_turn {Color::White};
+    uint64_t m_hash {0};
 
     std::array<Piece, 18 * 18> m_pieceStorage;
     etl::vector<Piece*, 18 * 18> m_pieces;
     std::array<Piece*, 18 * 18> m_board {nullptr};
+    std::array<unsigned, 2> m_pieceCount {0};
+    Piece* m_king {nullptr};
+
+    // Bit x of row y (and bit y of column x) is set for an occupied square
+    std::array<uint32_t, 18> m_rowOccupancy {0};
+    std::array<uint32_t, 18> m_columnOccupancy {0};
+    std::span<const uint16_t> m_slidingMoves;
 
-    etl::vector<Move, 18 * 18 * 18> m_possibleMoves;
+    // The first layer of the network scoring a playout, updated as pieces move
+    const NeuralNetwork* m_network {nullptr};
+    NeuralNetwork::Accumulator m_accumulator;
+
+    // The patterns of the squares for the playouts, as in PlayoutPolicy
+    bool m_hasPatterns {false};
+    std::array<uint16_t, 18 * 18> m_patterns;
 
     std::unique_ptr<IMoveTrait> m_moveTrait;
+
+    // The tree from the last search, and the moves played since. Copies don't have one.
+    std::shared_ptr<SearchTree> m_searchTree;
+    etl::vector<Move, kMaxMovesSinceSearch> m_movesSinceSearch;
 };
 
 } // namespace tafl
\ No newline at end of file
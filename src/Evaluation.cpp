@@ -0,0 +1,215 @@
+#include <Evaluation.hpp>
+#include <cmath>
+#include <fmt/format.h>
+#include <fstream>
+#include <sstream>
+
+using namespace tafl;
+
+namespace
+{
+
+constexpr std::array<const char*, Evaluation::kFeatures> kNames {
+    "bias",
+    "tempo",
+    "black-pieces",
+    "white-pieces",
+    "king-edge-distance",
+    "king-escapes",
+    "king-mobility",
+    "king-attackers",
+    "king-defenders",
+};
+
+constexpr Evaluation::Weights kDefaultWeights {
+    0.0f,   // Bias
+    0.1f,   // Tempo
+    -0.15f, // BlackPieces
+    0.25f,  // WhitePieces
+    -0.3f,  // KingEdgeDistance
+    1.5f,   // KingEscapes
+    0.05f,  // KingMobility
+    -0.5f,  // KingAttackers
+    0.1f,   // KingDefenders
+};
+
+} // namespace
+
+Evaluation::Evaluation()
+    : m_weights {kDefaultWeights}
+{
+}
+
+Evaluation::Evaluation(const Weights& weights)
+    : m_weights {weights}
+{
+}
+
+Evaluation::Features
+Evaluation::extract(const IBoard& board)
+{
+    Features out {};
+    const auto dim = board.getBoardDimension();
+
+    out[Bias] = 1;
+    out[Tempo] = board.getTurn() == Color::White ? 1 : -1;
+    out[BlackPieces] = static_cast<float>(board.getPieceCount(Color::Black));
+
+    auto king = board.getKingPosition();
+    if (!king)
+    {
+        out[WhitePieces] = static_cast<float>(board.getPieceCount(Color::White));
+        return out;
+    }
+    out[WhitePieces] = static_cast<float>(board.getPieceCount(Color::White) - 1);
+    out[KingEdgeDistance] =
+        static_cast<float>(std::min({king->x, king->y, dim - 1 - king->x, dim - 1 - king->y}));
+
+    std::array<Move, 4> escapes;
+    out[KingEscapes] = static_cast<float>(board.getKingEscapes(escapes).size());
+
+    // Squares off the board wrap around to large coordinates
+    constexpr std::array<std::pair<int, int>, 4> kDirections {{{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+    for (auto [dx, dy] : kDirections)
+    {
+        auto pos = Pos {king->x + dx, king->y + dy};
+        if (pos.x < dim && pos.y < dim)
+        {
+            if (auto type = board.pieceAt(pos))
+            {
+                out[*type == Piece::Type::Black ? KingAttackers : KingDefenders]++;
+                continue;
+            }
+        }
+
+        while (pos.x < dim && pos.y < dim && !board.pieceAt(pos))
+        {
+            out[KingMobility]++;
+            pos = Pos {pos.x + dx, pos.y + dy};
+        }
+    }
+
+    return out;
+}
+
+float
+Evaluation::score(const Features& features) const
+{
+    auto out = 0.0f;
+
+    for (auto i = 0u; i < kFeatures; i++)
+    {
+        out += m_weights[i] * features[i];
+    }
+
+    return out;
+}
+
+float
+Evaluation::score(const IBoard& board) const
+{
+    return score(extract(board));
+}
+
+float
+Evaluation::winRate(const IBoard& board, Color which) const
+{
+    auto white = 1.0f / (1.0f + std::exp(-score(board)));
+
+    return which == Color::White ? white : 1.0f - white;
+}
+
+const Evaluation::Weights&
+Evaluation::getWeights() const
+{
+    return m_weights;
+}
+
+const char*
+Evaluation::name(Feature feature)
+{
+    return kNames[feature];
+}
+
+std::optional<Evaluation>
+Evaluation::fromText(std::string_view text)
+{
+    Weights weights;
+    std::array<bool, kFeatures> found {};
+    std::istringstream in {std::string(text)};
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line.starts_with('#'))
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string feature;
+        float weight;
+        if (!(fields >> feature >> weight))
+        {
+            return std::nullopt;
+        }
+
+        // Unknown features are skipped, so that older engines read newer files
+        for (auto i = 0u; i < kFeatures; i++)
+        {
+            if (feature == kNames[i])
+            {
+                weights[i] = weight;
+                found[i] = true;
+            }
+        }
+    }
+
+    for (auto f : found)
+    {
+        if (!f)
+        {
+            return std::nullopt;
+        }
+    }
+
+    return Evaluation(weights);
+}
+
+std::string
+Evaluation::toText() const
+{
+    std::string out;
+
+    for (auto i = 0u; i < kFeatures; i++)
+    {
+        out += fmt::format("{} {}\n", kNames[i], m_weights[i]);
+    }
+
+    return out;
+}
+
+std::optional<Evaluation>
+Evaluation::load(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        return std::nullopt;
+    }
+
+    std::stringstream text;
+    text << in.rdbuf();
+
+    return fromText(text.str());
+}
+
+bool
+Evaluation::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::trunc);
+
+    out << toText();
+
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,214 @@
+#include <EvaluationTuner.hpp>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <mutex>
+#include <thread>
+
+using namespace tafl;
+
+namespace
+{
+
+// The positions scored at once, in the same order for each feature
+constexpr size_t kBlockSize = 256;
+
+// The partial sums of the gradient, one for each vector lane
+constexpr size_t kLanes = 8;
+
+unsigned
+threadCount(unsigned threads)
+{
+    return threads ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+} // namespace
+
+void
+EvaluationTuner::addGames(const GameRecordReader& reader, unsigned threads, unsigned skipPlies)
+{
+    std::mutex mutex;
+
+    reader.forEachPosition(
+        threadCount(threads), [&](const IBoard& board, const GameView& game, unsigned ply) {
+            if (ply < skipPlies || !game.getWinner())
+            {
+                return;
+            }
+
+            auto features = Evaluation::extract(board);
+
+            std::lock_guard lock(mutex);
+            for (auto i = 0u; i < Evaluation::kFeatures; i++)
+            {
+                m_features[i].push_back(features[i]);
+            }
+            m_results.push_back(*game.getWinner() == Color::White ? 1.0f : 0.0f);
+        });
+}
+
+void
+EvaluationTuner::addPosition(const IBoard& board, Color winner)
+{
+    auto features = Evaluation::extract(board);
+
+    for (auto i = 0u; i < Evaluation::kFeatures; i++)
+    {
+        m_features[i].push_back(features[i]);
+    }
+    m_results.push_back(winner == Color::White ? 1.0f : 0.0f);
+}
+
+size_t
+EvaluationTuner::getPositionCount() const
+{
+    return m_results.size();
+}
+
+double
+EvaluationTuner::getLoss(const Evaluation& evaluation, unsigned threads) const
+{
+    if (m_results.empty())
+    {
+        return 0;
+    }
+
+    return computeGradient(evaluation, threadCount(threads)).loss / m_results.size();
+}
+
+Evaluation
+EvaluationTuner::tune(const Evaluation& start,
+                      const TunerConfig& config,
+                      const std::function<void(unsigned epoch, double loss)>& onEpoch) const
+{
+    constexpr auto kBeta1 = 0.9;
+    constexpr auto kBeta2 = 0.999;
+    constexpr auto kEpsilon = 1e-8;
+
+    if (m_results.empty())
+    {
+        return start;
+    }
+
+    const auto threads = threadCount(config.threads);
+    const auto positions = static_cast<double>(m_results.size());
+    auto weights = start.getWeights();
+    std::array<double, Evaluation::kFeatures> mean {};
+    std::array<double, Evaluation::kFeatures> variance {};
+
+    for (auto epoch = 1u; epoch <= config.epochs; epoch++)
+    {
+        auto gradient = computeGradient(Evaluation(weights), threads);
+
+        onEpoch(epoch, gradient.loss / positions);
+
+        for (auto i = 0u; i < Evaluation::kFeatures; i++)
+        {
+            auto g = gradient.weights[i] / positions;
+
+            mean[i] = kBeta1 * mean[i] + (1 - kBeta1) * g;
+            variance[i] = kBeta2 * variance[i] + (1 - kBeta2) * g * g;
+
+            auto m = mean[i] / (1 - std::pow(kBeta1, epoch));
+            auto v = variance[i] / (1 - std::pow(kBeta2, epoch));
+            weights[i] -= static_cast<float>(config.learningRate * m / (std::sqrt(v) + kEpsilon));
+        }
+    }
+
+    return Evaluation(weights);
+}
+
+EvaluationTuner::Gradient
+EvaluationTuner::computeGradient(const Evaluation& evaluation, unsigned threads) const
+{
+    const auto positions = m_results.size();
+    // Whole blocks for each thread
+    const auto blocks = (positions + kBlockSize - 1) / kBlockSize;
+    const auto share = (blocks + threads - 1) / threads * kBlockSize;
+
+    std::vector<std::future<Gradient>> futures;
+    for (size_t begin = 0; begin < positions; begin += share)
+    {
+        futures.push_back(std::async(std::launch::async, [this, &evaluation, begin, share]() {
+            return computeGradient(
+                evaluation, begin, std::min(begin + share, m_results.size()));
+        }));
+    }
+
+    Gradient out;
+    for (auto& f : futures)
+    {
+        auto part = f.get();
+
+        for (auto i = 0u; i < Evaluation::kFeatures; i++)
+        {
+            out.weights[i] += part.weights[i];
+        }
+        out.loss += part.loss;
+    }
+
+    return out;
+}
+
+EvaluationTuner::Gradient
+EvaluationTuner::computeGradient(const Evaluation& evaluation, size_t begin, size_t end) const
+{
+    auto& weights = evaluation.getWeights();
+    Gradient out;
+
+    for (auto block = begin; block < end; block += kBlockSize)
+    {
+        const auto n = std::min(kBlockSize, end - block);
+        std::array<float, kBlockSize> scores {};
+        std::array<float, kBlockSize> errors {};
+
+        // Feature by feature, so that the loops run over consecutive positions
+        for (auto i = 0u; i < Evaluation::kFeatures; i++)
+        {
+            auto column = &m_features[i][block];
+
+            for (auto j = 0u; j < n; j++)
+            {
+                scores[j] += weights[i] * column[j];
+            }
+        }
+
+        auto results = &m_results[block];
+        for (auto j = 0u; j < n; j++)
+        {
+            auto score = scores[j];
+
+            errors[j] = 1.0f / (1.0f + std::exp(-score)) - results[j];
+            // The log loss, as log(1 + e^s) - y * s without overflowing
+            out.loss +=
+                std::log1p(std::exp(-std::abs(score))) + std::max(score, 0.0f) - results[j] * score;
+        }
+
+        for (auto i = 0u; i < Evaluation::kFeatures; i++)
+        {
+            auto column = &m_features[i][block];
+            std::array<float, kLanes> lanes {};
+
+            // In fixed lanes, which the compiler keeps in vector registers. The index is
+            // as wide as n, or the compiler can't count the iterations.
+            auto j = size_t {0};
+            for (; j + kLanes <= n; j += kLanes)
+            {
+                for (auto l = 0u; l < kLanes; l++)
+                {
+                    lanes[l] += errors[j + l] * column[j + l];
+                }
+            }
+            for (auto lane : lanes)
+            {
+                out.weights[i] += lane;
+            }
+            for (; j < n; j++)
+            {
+                out.weights[i] += errors[j] * column[j];
+            }
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,607 @@
+#include <GameRecords.hpp>
+#include <PositionFormat.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <future>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace tafl;
+
+namespace
+{
+
+constexpr auto kMagic = std::array {'T', 'A', 'F', 'L', 'G', 'R', '1', '\0'};
+constexpr uint32_t kBlockMagic = 0x4b4c4247; // "GBLK"
+
+// Blocks are written once their games take this many bytes
+constexpr size_t kBlockSize = 64 * 1024;
+
+constexpr size_t kMaxVariant = 15;
+
+struct FileHeader
+{
+    std::array<char, 8> magic;
+    std::array<char, kMaxVariant + 1> variant;
+    uint32_t dimension;
+    uint32_t reserved;
+    std::array<uint8_t, PositionFormat::kMaxPackedSize> start;
+    std::array<uint8_t, 2> padding;
+};
+
+// Headers are compared as bytes, so there must be no implicit padding
+static_assert(sizeof(FileHeader) == 116);
+
+struct BlockHeader
+{
+    uint32_t magic;
+    uint32_t games;
+    uint64_t size;
+    uint64_t positions;
+    uint64_t checksum;
+};
+
+// Each game starts with its number of moves, in two bytes, and its winner
+constexpr size_t kGameHeaderSize = 3;
+
+// The games of a block take at most one game more than kBlockSize
+constexpr size_t kMaxBlockSize = kBlockSize + 2 * UINT16_MAX + kGameHeaderSize;
+
+enum Winner : uint8_t
+{
+    None,
+    Black,
+    White,
+};
+
+// FNV-1a
+uint64_t
+checksum(std::span<const uint8_t> data)
+{
+    uint64_t out = 0xcbf29ce484222325ull;
+
+    for (auto byte : data)
+    {
+        out = (out ^ byte) * 0x100000001b3ull;
+    }
+
+    return out;
+}
+
+/*
+ * A move in two bytes: the square it's from in bits 0-8, whether it's along a column
+ * in bit 9 and the row or the column it goes to in bits 10-14.
+ */
+uint16_t
+encode(const Move& move, unsigned dimension)
+{
+    auto vertical = move.from.x == move.to.x;
+
+    return static_cast<uint16_t>(move.from.flatten(dimension) | (vertical ? 1 << 9 : 0) |
+                                 (vertical ? move.to.y : move.to.x) << 10);
+}
+
+Move
+decode(uint16_t code, unsigned dimension)
+{
+    auto square = code & 0x1ffu;
+    auto from = Pos {square % dimension, square / dimension};
+    auto to = from;
+
+    if (code >> 9 & 1)
+    {
+        to.y = code >> 10;
+    }
+    else
+    {
+        to.x = code >> 10;
+    }
+
+    return {from, to};
+}
+
+bool
+writeAll(int fd, std::span<const uint8_t> data)
+{
+    while (!data.empty())
+    {
+        auto written = ::write(fd, data.data(), data.size());
+        if (written <= 0)
+        {
+            return false;
+        }
+        data = data.subspan(static_cast<size_t>(written));
+    }
+
+    return true;
+}
+
+// Whether a move read from a file can be played on the board, so that damage which the
+// checksums missed can't take the board apart
+bool
+isPlayable(const IBoard& board, const Move& move)
+{
+    auto dim = board.getBoardDimension();
+    if (move.from.x >= dim || move.from.y >= dim || move.to.x >= dim || move.to.y >= dim)
+    {
+        return false;
+    }
+
+    auto piece = board.pieceAt(move.from);
+
+    return piece && Piece(*piece).getColor() == board.getTurn() && !board.pieceAt(move.to);
+}
+
+FileHeader
+makeHeader(const std::string& variant, const IBoard& start)
+{
+    FileHeader out {};
+
+    out.magic = kMagic;
+    std::copy_n(variant.begin(), std::min(variant.size(), kMaxVariant), out.variant.begin());
+    out.dimension = start.getBoardDimension();
+    PositionFormat::pack(start, out.start);
+
+    return out;
+}
+
+} // namespace
+
+GameView::GameView(std::span<const uint8_t> moves, std::optional<Color> winner, unsigned dimension)
+    : m_moves(moves)
+    , m_winner(winner)
+    , m_dimension(dimension)
+{
+}
+
+unsigned
+GameView::getPlies() const
+{
+    return static_cast<unsigned>(m_moves.size() / 2);
+}
+
+Move
+GameView::getMove(unsigned ply) const
+{
+    uint16_t code;
+    std::memcpy(&code, &m_moves[ply * 2], sizeof(code));
+
+    return decode(code, m_dimension);
+}
+
+std::optional<Color>
+GameView::getWinner() const
+{
+    return m_winner;
+}
+
+GameRecordWriter::GameRecordWriter(int fd, unsigned dimension)
+    : m_fd(fd)
+    , m_dimension(dimension)
+{
+    m_block.reserve(kMaxBlockSize);
+}
+
+GameRecordWriter::~GameRecordWriter()
+{
+    flush();
+    close(m_fd);
+}
+
+std::unique_ptr<GameRecordWriter>
+GameRecordWriter::open(const std::string& path, const std::string& variant, const IBoard& start)
+{
+    if (variant.size() > kMaxVariant || start.getBoardDimension() > PositionFormat::kMaxDimension)
+    {
+        return nullptr;
+    }
+
+    auto fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    auto expected = makeHeader(variant, start);
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    auto end = sizeof(FileHeader);
+    if (size < sizeof(FileHeader))
+    {
+        // A new file, or one whose header was cut short
+        if (ftruncate(fd, 0) != 0 ||
+            !writeAll(fd, {reinterpret_cast<const uint8_t*>(&expected), sizeof(expected)}))
+        {
+            close(fd);
+            return nullptr;
+        }
+    }
+    else
+    {
+        FileHeader header;
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+            std::memcmp(&header, &expected, sizeof(header)) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        // Append after the last complete block, dropping a block cut short at the end. A
+        // damaged header would drop all blocks after it, so such files are refused.
+        BlockHeader block;
+        while (end + sizeof(block) <= size)
+        {
+            if (pread(fd, &block, sizeof(block), static_cast<off_t>(end)) != sizeof(block) ||
+                block.magic != kBlockMagic || block.size > kMaxBlockSize)
+            {
+                close(fd);
+                return nullptr;
+            }
+            if (block.size > size - end - sizeof(block))
+            {
+                break;
+            }
+            end += sizeof(block) + block.size;
+        }
+        if (ftruncate(fd, static_cast<off_t>(end)) != 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+    }
+    lseek(fd, static_cast<off_t>(end), SEEK_SET);
+
+    return std::unique_ptr<GameRecordWriter>(new GameRecordWriter(fd, start.getBoardDimension()));
+}
+
+bool
+GameRecordWriter::add(std::span<const Move> moves, std::optional<Color> winner)
+{
+    if (moves.size() > UINT16_MAX)
+    {
+        return false;
+    }
+
+    std::lock_guard lock(m_mutex);
+
+    auto plies = static_cast<uint16_t>(moves.size());
+    auto offset = m_block.size();
+    m_block.resize(offset + kGameHeaderSize + 2 * moves.size());
+
+    auto out = &m_block[offset];
+    std::memcpy(out, &plies, sizeof(plies));
+    out[2] = !winner ? Winner::None : *winner == Color::Black ? Winner::Black : Winner::White;
+    for (auto i = 0u; i < moves.size(); i++)
+    {
+        auto code = encode(moves[i], m_dimension);
+        std::memcpy(out + kGameHeaderSize + 2 * i, &code, sizeof(code));
+    }
+    m_games++;
+    m_positions += moves.size() + 1;
+
+    return m_block.size() < kBlockSize || writeBlock();
+}
+
+bool
+GameRecordWriter::flush()
+{
+    std::lock_guard lock(m_mutex);
+
+    return m_block.empty() || writeBlock();
+}
+
+bool
+GameRecordWriter::writeBlock()
+{
+    BlockHeader header {kBlockMagic, m_games, m_block.size(), m_positions, checksum(m_block)};
+
+    auto written =
+        writeAll(m_fd, {reinterpret_cast<const uint8_t*>(&header), sizeof(header)}) &&
+        writeAll(m_fd, m_block);
+    m_block.clear();
+    m_games = 0;
+    m_positions = 0;
+
+    return written;
+}
+
+GameRecordReader::GameRecordReader(void* mapping, size_t size)
+    : m_mapping(mapping)
+    , m_size(size)
+    , m_data(static_cast<const uint8_t*>(mapping))
+{
+}
+
+GameRecordReader::~GameRecordReader()
+{
+    munmap(m_mapping, m_size);
+}
+
+std::unique_ptr<GameRecordReader>
+GameRecordReader::open(const std::string& path)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FileHeader))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (header.magic != kMagic || header.dimension < 2 ||
+        header.dimension > PositionFormat::kMaxDimension)
+    {
+        munmap(mapping, size);
+        return nullptr;
+    }
+
+    // The games are mostly read in the order of the file
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    auto out = std::unique_ptr<GameRecordReader>(new GameRecordReader(mapping, size));
+    out->m_variant = std::string(header.variant.data());
+    out->m_dimension = header.dimension;
+    out->m_start = std::span(out->m_data + offsetof(FileHeader, start),
+                             PositionFormat::packedSize(header.dimension));
+
+    // Up to the last complete block, from the headers only. The games of a block are
+    // checked when they're first read.
+    auto offset = sizeof(FileHeader);
+    BlockHeader block;
+    while (offset + sizeof(block) <= size)
+    {
+        std::memcpy(&block, out->m_data + offset, sizeof(block));
+        if (block.magic != kBlockMagic || block.size > kMaxBlockSize)
+        {
+            // Damage, so the blocks after it can't be found
+            out->m_damagedHeader = true;
+            break;
+        }
+        if (block.size > size - offset - sizeof(block))
+        {
+            break;
+        }
+
+        out->m_blocks.push_back(
+            {offset + sizeof(block), block.size, out->m_games, block.games, block.checksum});
+        out->m_games += block.games;
+        out->m_positions += block.positions;
+        offset += sizeof(block) + block.size;
+    }
+    out->m_blockStates = std::vector<std::atomic<BlockState>>(out->m_blocks.size());
+
+    return out;
+}
+
+const std::string&
+GameRecordReader::getVariant() const
+{
+    return m_variant;
+}
+
+unsigned
+GameRecordReader::getDimension() const
+{
+    return m_dimension;
+}
+
+std::unique_ptr<IBoard>
+GameRecordReader::getStart() const
+{
+    return PositionFormat::unpack(m_start, m_dimension);
+}
+
+uint64_t
+GameRecordReader::getGameCount() const
+{
+    return m_games;
+}
+
+uint64_t
+GameRecordReader::getPositionCount() const
+{
+    return m_positions;
+}
+
+std::optional<GameView>
+GameRecordReader::getGame(uint64_t index) const
+{
+    if (index >= m_games)
+    {
+        return std::nullopt;
+    }
+
+    // The block with the game, then the games before it in the block
+    auto block = std::ranges::upper_bound(
+                     m_blocks, index, {}, [](const Block& b) { return b.firstGame; }) -
+                 1;
+    if (!isIntact(static_cast<size_t>(block - m_blocks.begin())))
+    {
+        return std::nullopt;
+    }
+
+    auto offset = block->offset;
+
+    for (auto i = block->firstGame; i < index; i++)
+    {
+        offset = readGame(offset).second;
+    }
+
+    return readGame(offset).first;
+}
+
+bool
+GameRecordReader::verify() const
+{
+    if (m_damagedHeader)
+    {
+        return false;
+    }
+
+    for (auto b = 0u; b < m_blocks.size(); b++)
+    {
+        if (!isIntact(b))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+GameRecordReader::forEachGame(
+    unsigned threads,
+    const std::function<void(uint64_t index, const GameView& game)>& visit) const
+{
+    forEachBlock(threads, [this, &visit](const Block& block) {
+        auto offset = block.offset;
+
+        for (auto i = 0u; i < block.games; i++)
+        {
+            auto [game, next] = readGame(offset);
+
+            visit(block.firstGame + i, game);
+            offset = next;
+        }
+    });
+}
+
+void
+GameRecordReader::forEachPosition(
+    unsigned threads,
+    const std::function<void(const IBoard& board, const GameView& game, unsigned ply)>& visit)
+    const
+{
+    forEachBlock(threads, [this, &visit](const Block& block) {
+        // Reset to the starting position for each game, without allocating
+        auto board = getStart();
+        auto offset = block.offset;
+        for (auto i = 0u; i < block.games; i++)
+        {
+            auto [game, next] = readGame(offset);
+
+            PositionFormat::unpack(m_start, *board);
+            visit(*board, game, 0);
+            for (auto ply = 0u; ply < game.getPlies(); ply++)
+            {
+                auto move = game.getMove(ply);
+                if (!isPlayable(*board, move))
+                {
+                    break;
+                }
+                board->move(move);
+                visit(*board, game, ply + 1);
+            }
+            offset = next;
+        }
+    });
+}
+
+void
+GameRecordReader::forEachBlock(unsigned threads,
+                               const std::function<void(const Block& block)>& visit) const
+{
+    std::atomic<size_t> nextBlock {0};
+
+    auto work = [this, &nextBlock, &visit]() {
+        for (auto b = nextBlock++; b < m_blocks.size(); b = nextBlock++)
+        {
+            if (isIntact(b))
+            {
+                visit(m_blocks[b]);
+            }
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (auto thr = 0u; thr < std::max(threads, 1u); thr++)
+    {
+        workers.push_back(std::async(std::launch::async, work));
+    }
+    for (auto& worker : workers)
+    {
+        worker.get();
+    }
+}
+
+bool
+GameRecordReader::isIntact(size_t index) const
+{
+    // Threads which check a block at the same time come to the same result
+    auto& state = m_blockStates[index];
+    if (state.load(std::memory_order_acquire) == BlockState::Unchecked)
+    {
+        state.store(check(m_blocks[index]) ? BlockState::Intact : BlockState::Damaged,
+                    std::memory_order_release);
+    }
+
+    return state.load(std::memory_order_acquire) == BlockState::Intact;
+}
+
+bool
+GameRecordReader::check(const Block& block) const
+{
+    // The games must fill the block exactly, so that none can be read past its end
+    auto offset = block.offset;
+    auto end = block.offset + block.size;
+    for (auto i = 0u; i < block.games; i++)
+    {
+        if (end - offset < kGameHeaderSize)
+        {
+            return false;
+        }
+
+        uint16_t plies;
+        std::memcpy(&plies, m_data + offset, sizeof(plies));
+        if (end - offset - kGameHeaderSize < 2u * plies)
+        {
+            return false;
+        }
+        offset += kGameHeaderSize + 2u * plies;
+    }
+
+    return offset == end && checksum({m_data + block.offset, block.size}) == block.checksum;
+}
+
+std::pair<GameView, size_t>
+GameRecordReader::readGame(size_t offset) const
+{
+    uint16_t plies;
+    std::memcpy(&plies, m_data + offset, sizeof(plies));
+
+    auto winner = m_data[offset + 2];
+    auto moves = std::span(m_data + offset + kGameHeaderSize, 2 * plies);
+
+    return {GameView(moves,
+                     winner == Winner::None    ? std::nullopt
+                     : winner == Winner::Black ? std::optional(Color::Black)
+                                               : std::optional(Color::White),
+                     m_dimension),
+            offset + kGameHeaderSize + moves.size()};
+}
@@ -0,0 +1,169 @@
+#include <MemoryArena.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace tafl;
+
+namespace
+{
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+size_t
+roundUp(size_t value, size_t to)
+{
+    return (value + to - 1) / to * to;
+}
+
+std::mutex g_poolMutex;
+
+std::vector<std::unique_ptr<MemoryArena>>&
+pool()
+{
+    static std::vector<std::unique_ptr<MemoryArena>> arenas;
+
+    return arenas;
+}
+
+} // namespace
+
+MemoryArena::MemoryArena(size_t size)
+    : m_size(roundUp(size, kHugePageSize))
+{
+    void* p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    // Explicit huge pages, if the system has reserved any
+    p = mmap(nullptr,
+             m_size,
+             PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,
+             -1,
+             0);
+    m_hugePages = p != MAP_FAILED;
+#endif
+
+    if (p == MAP_FAILED)
+    {
+        p = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            m_size = 0;
+            return;
+        }
+
+#ifdef MADV_HUGEPAGE
+        madvise(p, m_size, MADV_HUGEPAGE);
+#endif
+
+        // Prefault, so that the search doesn't take the page faults
+        const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        for (size_t offset = 0; offset < m_size; offset += pageSize)
+        {
+            static_cast<volatile std::byte*>(p)[offset] = std::byte {0};
+        }
+    }
+
+    m_memory = static_cast<std::byte*>(p);
+}
+
+MemoryArena::~MemoryArena()
+{
+    if (m_memory)
+    {
+        munmap(m_memory, m_size);
+    }
+}
+
+void*
+MemoryArena::allocate(size_t size, size_t alignment)
+{
+    auto start = roundUp(reinterpret_cast<uintptr_t>(m_memory) + m_used, alignment) -
+                 reinterpret_cast<uintptr_t>(m_memory);
+
+    if (!m_memory || start + size > m_size)
+    {
+        return nullptr;
+    }
+
+    m_used = start + size;
+
+    return m_memory + start;
+}
+
+void
+MemoryArena::reset()
+{
+    m_used = 0;
+}
+
+size_t
+MemoryArena::size() const
+{
+    return m_size;
+}
+
+size_t
+MemoryArena::used() const
+{
+    return m_used;
+}
+
+bool
+MemoryArena::hasHugePages() const
+{
+    return m_hugePages;
+}
+
+void
+MemoryArena::Releaser::operator()(MemoryArena* arena) const
+{
+    std::lock_guard lock(g_poolMutex);
+
+    pool().emplace_back(arena);
+}
+
+MemoryArena::Lease
+MemoryArena::acquire(size_t size)
+{
+    const auto rounded = roundUp(size, kHugePageSize);
+    std::unique_ptr<MemoryArena> arena;
+    std::vector<std::unique_ptr<MemoryArena>> unused;
+
+    {
+        std::lock_guard lock(g_poolMutex);
+        auto& arenas = pool();
+        auto it = std::find_if(arenas.rbegin(), arenas.rend(), [rounded](auto& pooled) {
+            return pooled->size() == rounded;
+        });
+
+        if (it != arenas.rend())
+        {
+            arena = std::move(*it);
+            arenas.erase(std::next(it).base());
+        }
+        else
+        {
+            unused.swap(arenas);
+        }
+    }
+
+    if (!arena)
+    {
+        // Unmapped without the lock, and before the new arena is mapped
+        unused.clear();
+        arena = std::make_unique<MemoryArena>(size);
+        if (arena->size() == 0)
+        {
+            return nullptr;
+        }
+    }
+    arena->reset();
+
+    return Lease(arena.release());
+}
@@ -0,0 +1,407 @@
+#include <NeuralNetwork.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TAFL_HAVE_AVX2_KERNELS
+#endif
+
+using namespace tafl;
+
+namespace
+{
+
+constexpr std::array<uint8_t, 8> kMagic {'T', 'A', 'F', 'L', 'N', 'N', '1', '\0'};
+constexpr size_t kHeaderSize = kMagic.size() + 2 * sizeof(uint32_t);
+constexpr auto kHidden = NeuralNetwork::kHidden;
+
+// The kernels, chosen for the processor
+struct Kernels
+{
+    void (*add)(int16_t* accumulator, const int16_t* row);
+    void (*subtract)(int16_t* accumulator, const int16_t* row);
+    void (*move)(int16_t* accumulator, const int16_t* from, const int16_t* to);
+    int32_t (*output)(const int16_t* accumulator, const int16_t* weights);
+};
+
+void
+addScalar(int16_t* accumulator, const int16_t* row)
+{
+    for (auto i = 0u; i < kHidden; i++)
+    {
+        accumulator[i] = static_cast<int16_t>(accumulator[i] + row[i]);
+    }
+}
+
+void
+subtractScalar(int16_t* accumulator, const int16_t* row)
+{
+    for (auto i = 0u; i < kHidden; i++)
+    {
+        accumulator[i] = static_cast<int16_t>(accumulator[i] - row[i]);
+    }
+}
+
+void
+moveScalar(int16_t* accumulator, const int16_t* from, const int16_t* to)
+{
+    for (auto i = 0u; i < kHidden; i++)
+    {
+        accumulator[i] = static_cast<int16_t>(accumulator[i] - from[i] + to[i]);
+    }
+}
+
+int32_t
+outputScalar(const int16_t* accumulator, const int16_t* weights)
+{
+    int32_t out = 0;
+
+    for (auto i = 0u; i < kHidden; i++)
+    {
+        auto activation = std::clamp<int32_t>(accumulator[i], 0, NeuralNetwork::kActivationMax);
+
+        out += activation * weights[i];
+    }
+
+    return out;
+}
+
+#ifdef TAFL_HAVE_AVX2_KERNELS
+
+// 16 values to a register. The accumulator is aligned, the rows of weights aren't.
+constexpr auto kLanes = 16u;
+
+__attribute__((target("avx2"))) void
+addAvx2(int16_t* accumulator, const int16_t* row)
+{
+    for (auto i = 0u; i < kHidden; i += kLanes)
+    {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+        auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(accumulator + i), _mm256_add_epi16(a, r));
+    }
+}
+
+__attribute__((target("avx2"))) void
+subtractAvx2(int16_t* accumulator, const int16_t* row)
+{
+    for (auto i = 0u; i < kHidden; i += kLanes)
+    {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+        auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(accumulator + i), _mm256_sub_epi16(a, r));
+    }
+}
+
+__attribute__((target("avx2"))) void
+moveAvx2(int16_t* accumulator, const int16_t* from, const int16_t* to)
+{
+    for (auto i = 0u; i < kHidden; i += kLanes)
+    {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+        auto f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + i));
+        auto t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(to + i));
+
+        a = _mm256_add_epi16(_mm256_sub_epi16(a, f), t);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(accumulator + i), a);
+    }
+}
+
+__attribute__((target("avx2"))) int32_t
+outputAvx2(const int16_t* accumulator, const int16_t* weights)
+{
+    const auto zero = _mm256_setzero_si256();
+    const auto max = _mm256_set1_epi16(NeuralNetwork::kActivationMax);
+    auto sum = _mm256_setzero_si256();
+
+    for (auto i = 0u; i < kHidden; i += kLanes)
+    {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(accumulator + i));
+        auto w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+
+        a = _mm256_min_epi16(_mm256_max_epi16(a, zero), max);
+        // Pairs of products summed into 32 bits, which can't overflow for 255 * 32767
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, w));
+    }
+
+    auto half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(half);
+}
+
+#endif
+
+// The AVX2 kernels if asked for and the processor has them, the plain loops otherwise
+Kernels
+selectKernels(bool avx2)
+{
+#ifdef TAFL_HAVE_AVX2_KERNELS
+    if (avx2 && NeuralNetwork::hasAvx2())
+    {
+        return {addAvx2, subtractAvx2, moveAvx2, outputAvx2};
+    }
+#endif
+
+    return {addScalar, subtractScalar, moveScalar, outputScalar};
+}
+
+Kernels g_kernels = selectKernels(true);
+
+template <typename T>
+void
+put(std::vector<uint8_t>& out, T value)
+{
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+
+    for (auto i = 0u; i < sizeof(T); i++)
+    {
+        out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+}
+
+template <typename T>
+T
+get(std::span<const uint8_t>& in)
+{
+    std::make_unsigned_t<T> bits = 0;
+
+    for (auto i = 0u; i < sizeof(T); i++)
+    {
+        bits |= static_cast<std::make_unsigned_t<T>>(in[i]) << (8 * i);
+    }
+    in = in.subspan(sizeof(T));
+
+    return static_cast<T>(bits);
+}
+
+} // namespace
+
+NeuralNetwork::NeuralNetwork(Parameters parameters)
+    : m_parameters(std::move(parameters))
+{
+}
+
+std::unique_ptr<NeuralNetwork>
+NeuralNetwork::create(Parameters parameters)
+{
+    if (parameters.dimension == 0 || parameters.dimension > 18 ||
+        parameters.hiddenWeights.size() != inputCount(parameters.dimension) * kHidden)
+    {
+        return nullptr;
+    }
+
+    return std::unique_ptr<NeuralNetwork>(new NeuralNetwork(std::move(parameters)));
+}
+
+std::unique_ptr<NeuralNetwork>
+NeuralNetwork::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return nullptr;
+    }
+
+    std::vector<uint8_t> bytes {std::istreambuf_iterator<char>(in),
+                                std::istreambuf_iterator<char>()};
+
+    return fromBytes(bytes);
+}
+
+std::unique_ptr<NeuralNetwork>
+NeuralNetwork::fromBytes(std::span<const uint8_t> bytes)
+{
+    if (bytes.size() < kHeaderSize || !std::ranges::equal(bytes.first(kMagic.size()), kMagic))
+    {
+        return nullptr;
+    }
+    bytes = bytes.subspan(kMagic.size());
+
+    Parameters parameters;
+    parameters.dimension = get<uint32_t>(bytes);
+    auto hidden = get<uint32_t>(bytes);
+    if (hidden != kHidden || parameters.dimension == 0 || parameters.dimension > 18)
+    {
+        return nullptr;
+    }
+
+    const auto weights = inputCount(parameters.dimension) * kHidden;
+    const auto size = (kHidden + weights + 2 * kHidden) * sizeof(int16_t) + 2 * sizeof(int32_t);
+    if (bytes.size() != size)
+    {
+        return nullptr;
+    }
+
+    for (auto& bias : parameters.hiddenBiases)
+    {
+        bias = get<int16_t>(bytes);
+    }
+    parameters.hiddenWeights.resize(weights);
+    for (auto& weight : parameters.hiddenWeights)
+    {
+        weight = get<int16_t>(bytes);
+    }
+    for (auto& weight : parameters.outputWeights)
+    {
+        weight = get<int16_t>(bytes);
+    }
+    for (auto& bias : parameters.outputBiases)
+    {
+        bias = get<int32_t>(bytes);
+    }
+
+    return create(std::move(parameters));
+}
+
+std::vector<uint8_t>
+NeuralNetwork::toBytes() const
+{
+    std::vector<uint8_t> out(kMagic.begin(), kMagic.end());
+
+    put<uint32_t>(out, m_parameters.dimension);
+    put<uint32_t>(out, kHidden);
+    for (auto bias : m_parameters.hiddenBiases)
+    {
+        put(out, bias);
+    }
+    for (auto weight : m_parameters.hiddenWeights)
+    {
+        put(out, weight);
+    }
+    for (auto weight : m_parameters.outputWeights)
+    {
+        put(out, weight);
+    }
+    for (auto bias : m_parameters.outputBiases)
+    {
+        put(out, bias);
+    }
+
+    return out;
+}
+
+bool
+NeuralNetwork::save(const std::string& path) const
+{
+    auto bytes = toBytes();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+    return static_cast<bool>(out);
+}
+
+const NeuralNetwork::Parameters&
+NeuralNetwork::getParameters() const
+{
+    return m_parameters;
+}
+
+size_t
+NeuralNetwork::inputCount(unsigned dimension)
+{
+    return 3 * dimension * dimension;
+}
+
+const int16_t*
+NeuralNetwork::row(Piece::Type type, const Pos& pos) const
+{
+    const auto dim = m_parameters.dimension;
+    // Black, white and the king are 1, 2 and 3
+    auto input = (static_cast<unsigned>(type) - 1) * dim * dim + pos.flatten(dim);
+
+    return &m_parameters.hiddenWeights[input * kHidden];
+}
+
+void
+NeuralNetwork::refresh(const IBoard& board, Accumulator& accumulator) const
+{
+    std::array<Piece, 18 * 18> pieces;
+
+    accumulator.values = m_parameters.hiddenBiases;
+    for (auto color : {Color::Black, Color::White})
+    {
+        for (auto& piece : board.getPieces(color, pieces))
+        {
+            g_kernels.add(accumulator.values.data(), row(piece.getType(), piece.getPosition()));
+        }
+    }
+}
+
+void
+NeuralNetwork::addPiece(Accumulator& accumulator, Piece::Type type, const Pos& pos) const
+{
+    g_kernels.add(accumulator.values.data(), row(type, pos));
+}
+
+void
+NeuralNetwork::removePiece(Accumulator& accumulator, Piece::Type type, const Pos& pos) const
+{
+    g_kernels.subtract(accumulator.values.data(), row(type, pos));
+}
+
+void
+NeuralNetwork::movePiece(Accumulator& accumulator,
+                         Piece::Type type,
+                         const Pos& from,
+                         const Pos& to) const
+{
+    g_kernels.move(accumulator.values.data(), row(type, from), row(type, to));
+}
+
+float
+NeuralNetwork::score(const Accumulator& accumulator, Color turn) const
+{
+    auto side = turn == Color::White ? 0u : 1u;
+    auto out = g_kernels.output(accumulator.values.data(),
+                                m_parameters.outputWeights.data() + side * kHidden) +
+               m_parameters.outputBiases[side];
+
+    return static_cast<float>(out) / (kActivationMax * kWeightScale);
+}
+
+float
+NeuralNetwork::winRate(const Accumulator& accumulator, Color turn, Color which) const
+{
+    auto white = 1.0f / (1.0f + std::exp(-score(accumulator, turn)));
+
+    return which == Color::White ? white : 1.0f - white;
+}
+
+float
+NeuralNetwork::winRate(const IBoard& board, Color which) const
+{
+    Accumulator accumulator;
+
+    refresh(board, accumulator);
+
+    return winRate(accumulator, board.getTurn(), which);
+}
+
+bool
+NeuralNetwork::hasAvx2()
+{
+#ifdef TAFL_HAVE_AVX2_KERNELS
+    // Also called before main(), so maybe before the processor was identified
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+bool
+NeuralNetwork::useAvx2(bool use)
+{
+    g_kernels = selectKernels(use);
+
+    return g_kernels.add != addScalar;
+}
@@ -45,20 +45,32 @@ Piece::getColor() const
 
 std::unique_ptr<Piece>
 Piece::fromChar(char c)
+{
+    auto type = typeFromChar(c);
+    if (!type)
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<Piece>(*type);
+}
+
+std::optional<Piece::Type>
+Piece::typeFromChar(char c)
 {
     switch (tolower(c))
     {
     case 'w':
-        return std::make_unique<Piece>(Piece::Type::White);
+        return Piece::Type::White;
     case 'k':
-        return std::make_unique<Piece>(Piece::Type::King);
+        return Piece::Type::King;
     case 'b':
-        return std::make_unique<Piece>(Piece::Type::Black);
+        return Piece::Type::Black;
     default:
         break;
     }
 
-    return nullptr;
+    return std::nullopt;
 }
 
 char
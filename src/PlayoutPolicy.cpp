@@ -0,0 +1,100 @@
+#include <PlayoutPolicy.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace tafl;
+
+namespace
+{
+
+// The weight of a move with nothing special about its destination
+constexpr auto kBaseWeight = 64.0;
+
+constexpr auto kEmpty = 0u;
+constexpr auto kBlack = PlayoutPolicy::code(Piece::Type::Black);
+constexpr auto kWhite = PlayoutPolicy::code(Piece::Type::White);
+constexpr auto kKing = PlayoutPolicy::code(Piece::Type::King);
+
+// The preference for a line of a pattern, in quarters of a doubling of the weight
+int
+score(Color mover, unsigned line)
+{
+    // The squares at a distance of 1 and 2 on one side, and then on the other side
+    auto at = [line](unsigned side, unsigned distance) {
+        return (line >> PlayoutPolicy::shift(side, distance)) & 3u;
+    };
+    auto isFriend = [mover](unsigned code) {
+        return mover == Color::Black ? code == kBlack : code == kWhite || code == kKing;
+    };
+    // The king captures too, but can't be captured like the others
+    auto isEnemy = [mover](unsigned code) {
+        return mover == Color::Black ? code == kWhite || code == kKing : code == kBlack;
+    };
+    auto out = 0;
+
+    for (auto side : {0u, 1u})
+    {
+        auto next = at(side, 1);
+        auto beyond = at(side, 2);
+
+        // A capture
+        if (isEnemy(next) && next != kKing && isFriend(beyond))
+        {
+            out += 8;
+        }
+
+        // Closing in on the king
+        if (mover == Color::Black && next == kKing)
+        {
+            out += 6;
+        }
+        else if (mover == Color::Black && next == kEmpty && beyond == kKing)
+        {
+            out += 2;
+        }
+    }
+
+    // An enemy on one side and room for another on the other side
+    auto one = at(0, 1);
+    auto other = at(1, 1);
+    if ((isEnemy(one) && other == kEmpty) || (isEnemy(other) && one == kEmpty))
+    {
+        out -= 4;
+    }
+
+    return out;
+}
+
+} // namespace
+
+const std::array<std::array<uint8_t, 256>, 2> PlayoutPolicy::kLineScores = []() {
+    std::array<std::array<uint8_t, 256>, 2> out;
+
+    for (auto mover : {Color::Black, Color::White})
+    {
+        for (auto line = 0u; line < out[0].size(); line++)
+        {
+            out[static_cast<unsigned>(mover)][line] = static_cast<uint8_t>(
+                std::clamp(score(mover, line), kMinLineScore, kMaxLineScore) - kMinLineScore);
+        }
+    }
+
+    return out;
+}();
+
+const std::array<uint8_t, 2 * (PlayoutPolicy::kMaxLineScore - PlayoutPolicy::kMinLineScore) + 1>
+    PlayoutPolicy::kWeights = []() {
+        std::array<uint8_t, 2 * (kMaxLineScore - kMinLineScore) + 1> out;
+
+        for (auto sum = 0u; sum < out.size(); sum++)
+        {
+            auto quarters = static_cast<int>(sum) + 2 * kMinLineScore;
+            auto weight = kBaseWeight * std::exp2(quarters / 4.0);
+
+            out[sum] = static_cast<uint8_t>(
+                std::clamp(std::lround(weight), 1l, static_cast<long>(kMaxWeight)));
+        }
+
+        return out;
+    }();
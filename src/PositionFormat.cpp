@@ -0,0 +1,167 @@
+#include <PositionFormat.hpp>
+#include <algorithm>
+
+using namespace tafl;
+
+namespace
+{
+
+// Not a character of the text form, so that the two are told apart by the first byte
+constexpr std::array<uint8_t, 6> kMagic {0x89, 'T', 'A', 'F', 'L', 'P'};
+constexpr uint8_t kVersion = 1;
+
+static_assert(PositionFormat::kMaxPackedSize ==
+              PositionFormat::packedSize(PositionFormat::kMaxDimension));
+
+// The 2-bit codes of the squares are the piece types
+static_assert(static_cast<unsigned>(Piece::Type::Unset) == 0 &&
+              static_cast<unsigned>(Piece::Type::Black) == 1 &&
+              static_cast<unsigned>(Piece::Type::White) == 2 &&
+              static_cast<unsigned>(Piece::Type::King) == 3);
+
+} // namespace
+
+bool
+PositionFormat::pack(const IBoard& board, std::span<uint8_t> out)
+{
+    const auto dim = board.getBoardDimension();
+    if (dim > kMaxDimension || out.size() < packedSize(dim))
+    {
+        return false;
+    }
+
+    std::ranges::fill(out.first(packedSize(dim)), 0);
+    if (board.getTurn() == Color::Black)
+    {
+        out[dim * dim / 4] |= static_cast<uint8_t>(1 << (dim * dim % 4 * 2));
+    }
+
+    std::array<Piece, kMaxDimension * kMaxDimension> pieces;
+    for (auto color : {Color::Black, Color::White})
+    {
+        for (auto& piece : board.getPieces(color, pieces))
+        {
+            auto square = piece.getPosition().flatten(dim);
+            auto code = static_cast<unsigned>(piece.getType());
+
+            out[square / 4] |= static_cast<uint8_t>(code << (square % 4 * 2));
+        }
+    }
+
+    return true;
+}
+
+bool
+PositionFormat::unpack(std::span<const uint8_t> in, IBoard& board)
+{
+    const auto dim = board.getBoardDimension();
+    if (dim > kMaxDimension || in.size() < packedSize(dim))
+    {
+        return false;
+    }
+
+    std::array<Piece::Type, kMaxDimension * kMaxDimension> squares;
+    for (auto i = 0u; i < dim * dim; i++)
+    {
+        squares[i] = static_cast<Piece::Type>((in[i / 4] >> (i % 4 * 2)) & 3);
+    }
+    auto black = (in[dim * dim / 4] >> (dim * dim % 4 * 2)) & 1;
+
+    return board.setPosition(std::span(squares.data(), dim * dim),
+                             black ? Color::Black : Color::White);
+}
+
+std::unique_ptr<IBoard>
+PositionFormat::unpack(std::span<const uint8_t> in, unsigned dimension)
+{
+    if (dimension < 2 || dimension > kMaxDimension || in.size() < packedSize(dimension))
+    {
+        return nullptr;
+    }
+
+    auto board = IBoard::fromString(std::string(dimension * dimension, ' '));
+    unpack(in, *board);
+
+    return board;
+}
+
+std::string
+PositionFormat::toText(const IBoard& board)
+{
+    const auto dim = board.getBoardDimension();
+    std::string out(dim * dim, ' ');
+
+    for (auto i = 0u; i < dim * dim; i++)
+    {
+        auto piece = board.pieceAt({i % dim, i / dim});
+        if (piece)
+        {
+            out[i] = Piece::toChar(*piece);
+        }
+    }
+    out += board.getTurn() == Color::Black ? ";b" : ";w";
+
+    return out;
+}
+
+std::unique_ptr<IBoard>
+PositionFormat::fromText(std::string_view text)
+{
+    auto turn = Color::White;
+
+    auto separator = text.rfind(';');
+    if (separator != std::string_view::npos)
+    {
+        auto suffix = text.substr(separator + 1);
+        if (suffix != "w" && suffix != "b")
+        {
+            return nullptr;
+        }
+        turn = suffix == "b" ? Color::Black : Color::White;
+        text = text.substr(0, separator);
+    }
+
+    auto board = IBoard::fromString(text);
+    if (board)
+    {
+        board->setTurn(turn);
+    }
+
+    return board;
+}
+
+std::array<uint8_t, PositionFormat::kHeaderSize>
+PositionFormat::header(unsigned dimension)
+{
+    std::array<uint8_t, kHeaderSize> out {};
+
+    std::ranges::copy(kMagic, out.begin());
+    out[kMagic.size()] = kVersion;
+    out[kMagic.size() + 1] = static_cast<uint8_t>(dimension);
+
+    return out;
+}
+
+std::optional<unsigned>
+PositionFormat::parseHeader(std::span<const uint8_t> in)
+{
+    if (in.size() < kHeaderSize || !std::ranges::equal(in.first(kMagic.size()), kMagic) ||
+        in[kMagic.size()] != kVersion)
+    {
+        return std::nullopt;
+    }
+
+    auto dimension = in[kMagic.size() + 1];
+    if (dimension < 2 || dimension > kMaxDimension)
+    {
+        return std::nullopt;
+    }
+
+    return dimension;
+}
+
+bool
+PositionFormat::isHeaderStart(int c)
+{
+    return c == kMagic[0];
+}
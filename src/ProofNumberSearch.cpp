@@ -0,0 +1,241 @@
+#include "ProofNumberSearch.hpp"
+
+#include <algorithm>
+
+using namespace tafl;
+
+namespace
+{
+
+uint32_t
+add(uint32_t a, uint32_t b, uint32_t infinity)
+{
+    return std::min(a + b, infinity);
+}
+
+} // namespace
+
+ProofNumberSearch::ProofNumberSearch(const ProofConfig& config)
+    : m_config(config)
+{
+}
+
+ProofResult
+ProofNumberSearch::run(const Board& root)
+{
+    const auto attacking = root.getTurn() == m_config.attacker;
+    ProofResult out;
+
+    // The moves of the attacker, and the replies of the defender in between
+    auto plies = m_config.moves * 2;
+    if (attacking && plies > 0)
+    {
+        plies--;
+    }
+
+    auto numbers = search(root, plies, kInfinity, kInfinity);
+    if (numbers.proof == 0)
+    {
+        out.proof = Proof::Proven;
+    }
+    else if (numbers.disproof == 0)
+    {
+        out.proof = Proof::Disproven;
+    }
+
+    // The child which proves or disproves the root
+    if (plies > 0 && ((out.proof == Proof::Proven && attacking) ||
+                      (out.proof == Proof::Disproven && !attacking)))
+    {
+        std::vector<Child> children;
+
+        expand(root, plies, children);
+        for (auto& child : children)
+        {
+            auto childNumbers = lookup(child.key);
+
+            if ((attacking ? childNumbers.proof : childNumbers.disproof) == 0)
+            {
+                out.move = child.move;
+                break;
+            }
+        }
+    }
+    out.nodes = m_nodes;
+
+    return out;
+}
+
+ProofNumberSearch::Numbers
+ProofNumberSearch::search(const Board& board,
+                          unsigned plies,
+                          uint32_t proofThreshold,
+                          uint32_t disproofThreshold)
+{
+    const auto key = this->key(board, plies);
+    m_nodes++;
+
+    if (auto numbers = evaluate(board, plies))
+    {
+        m_table[key] = *numbers;
+        return *numbers;
+    }
+
+    std::vector<Child> children;
+    expand(board, plies, children);
+
+    const auto attacking = board.getTurn() == m_config.attacker;
+    Numbers numbers;
+    while (true)
+    {
+        if (children.empty())
+        {
+            // Not a loss by the rules, so the attacker hasn't won
+            numbers = {kInfinity, 0};
+            break;
+        }
+
+        // The attacker needs one proven move, the defender one disproven move
+        numbers = attacking ? Numbers {kInfinity, 0} : Numbers {0, kInfinity};
+
+        const Child* best = nullptr;
+        Numbers bestNumbers;
+        auto second = kInfinity;
+        for (auto& child : children)
+        {
+            auto childNumbers = lookup(child.key);
+            auto value = attacking ? childNumbers.proof : childNumbers.disproof;
+
+            if (attacking)
+            {
+                numbers.proof = std::min(numbers.proof, childNumbers.proof);
+                numbers.disproof = add(numbers.disproof, childNumbers.disproof, kInfinity);
+            }
+            else
+            {
+                numbers.proof = add(numbers.proof, childNumbers.proof, kInfinity);
+                numbers.disproof = std::min(numbers.disproof, childNumbers.disproof);
+            }
+
+            if (!best || value < (attacking ? bestNumbers.proof : bestNumbers.disproof))
+            {
+                if (best)
+                {
+                    second = attacking ? bestNumbers.proof : bestNumbers.disproof;
+                }
+                best = &child;
+                bestNumbers = childNumbers;
+            }
+            else
+            {
+                second = std::min(second, value);
+            }
+        }
+
+        if (numbers.proof >= proofThreshold || numbers.disproof >= disproofThreshold ||
+            m_nodes >= m_config.nodeLimit)
+        {
+            break;
+        }
+
+        // Search the best child until it's no longer better than the second best
+        auto next = board;
+        next.move(best->move);
+        if (attacking)
+        {
+            search(next,
+                   plies - 1,
+                   std::min(proofThreshold, add(second, 1, kInfinity)),
+                   add(disproofThreshold - numbers.disproof, bestNumbers.disproof, kInfinity));
+        }
+        else
+        {
+            search(next,
+                   plies - 1,
+                   add(proofThreshold - numbers.proof, bestNumbers.proof, kInfinity),
+                   std::min(disproofThreshold, add(second, 1, kInfinity)));
+        }
+    }
+
+    m_table[key] = numbers;
+
+    return numbers;
+}
+
+std::optional<ProofNumberSearch::Numbers>
+ProofNumberSearch::evaluate(const Board& board, unsigned plies) const
+{
+    const auto proven = Numbers {0, kInfinity};
+    const auto disproven = Numbers {kInfinity, 0};
+
+    if (auto winner = board.getWinner())
+    {
+        return *winner == m_config.attacker ? proven : disproven;
+    }
+    if (plies == 0)
+    {
+        return disproven;
+    }
+    if (plies == 1 && board.getTurn() == m_config.attacker)
+    {
+        // The last move, so no need to try them all
+        return winsNow(board) ? proven : disproven;
+    }
+
+    if (auto it = m_table.find(key(board, plies));
+        it != m_table.end() && (it->second.proof == 0 || it->second.disproof == 0))
+    {
+        return it->second;
+    }
+
+    return std::nullopt;
+}
+
+bool
+ProofNumberSearch::winsNow(const Board& board) const
+{
+    if (m_config.attacker == Color::White)
+    {
+        return board.findKingEscapes().lines != 0;
+    }
+
+    auto captures = false;
+    board.forEachPossibleMove(
+        [&board, &captures](const Move& move) { captures = captures || board.capturesKing(move); });
+
+    return captures;
+}
+
+void
+ProofNumberSearch::expand(const Board& board, unsigned plies, std::vector<Child>& children)
+{
+    board.forEachPossibleMove([this, &board, plies, &children](const Move& move) {
+        auto child = board;
+
+        child.move(move);
+        auto childKey = key(child, plies - 1);
+        if (auto numbers = evaluate(child, plies - 1))
+        {
+            m_table[childKey] = *numbers;
+            m_nodes++;
+        }
+        children.push_back({move, childKey});
+    });
+}
+
+ProofNumberSearch::Numbers
+ProofNumberSearch::lookup(uint64_t key) const
+{
+    if (auto it = m_table.find(key); it != m_table.end())
+    {
+        return it->second;
+    }
+
+    return Numbers {};
+}
+
+uint64_t
+ProofNumberSearch::key(const Board& board, unsigned plies) const
+{
+    return board.hash() ^ (plies * 0x9e3779b97f4a7c15ull);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Board.hpp"
+
+#include <ProofConfig.hpp>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace tafl
+{
+
+/*
+ * A depth-first proof-number search (df-pn), proving or disproving that the attacker
+ * wins within a number of moves.
+ *
+ * The proof number of a position is the least number of leaves which must be proven
+ * for the attacker to win, and the disproof number the least number which must be
+ * disproven for the defender to hold. The search descends into the most promising
+ * child until its numbers exceed thresholds given by its siblings, so only the numbers
+ * of the visited positions are kept, in a table.
+ */
+class ProofNumberSearch
+{
+public:
+    explicit ProofNumberSearch(const ProofConfig& config);
+
+    ProofResult run(const Board& root);
+
+private:
+    static constexpr uint32_t kInfinity = std::numeric_limits<uint32_t>::max() / 2;
+
+    struct Numbers
+    {
+        uint32_t proof {1};
+        uint32_t disproof {1};
+    };
+
+    struct Child
+    {
+        Move move;
+        uint64_t key;
+    };
+
+    // Search a position until it's solved or its numbers reach the thresholds
+    Numbers
+    search(const Board& board, unsigned plies, uint32_t proofThreshold, uint32_t disproofThreshold);
+
+    // The numbers of a position which is solved without searching, or std::nullopt
+    std::optional<Numbers> evaluate(const Board& board, unsigned plies) const;
+
+    // Can the attacker win with the next move?
+    bool winsNow(const Board& board) const;
+
+    // Generate the children of a position, and store the ones which are solved directly
+    void expand(const Board& board, unsigned plies, std::vector<Child>& children);
+
+    Numbers lookup(uint64_t key) const;
+
+    // The table key for a position with a number of plies left
+    uint64_t key(const Board& board, unsigned plies) const;
+
+    const ProofConfig m_config;
+    std::unordered_map<uint64_t, Numbers> m_table;
+    uint64_t m_nodes {0};
+};
+
+} // namespace tafl
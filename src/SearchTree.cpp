@@ -0,0 +1,1014 @@
+#include "SearchTree.hpp"
+
+#include "ProofNumberSearch.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <new>
+
+using namespace tafl;
+
+std::shared_ptr<SearchTree>
+SearchTree::create(const Board& root, size_t memoryLimit)
+{
+    if (memoryLimit < kMinMemoryLimit)
+    {
+        return nullptr;
+    }
+
+    auto arena = MemoryArena::acquire(memoryLimit);
+    if (!arena)
+    {
+        return nullptr;
+    }
+
+    return std::shared_ptr<SearchTree>(new SearchTree(root, memoryLimit, std::move(arena)));
+}
+
+SearchTree::SearchTree(const Board& root, size_t memoryLimit, MemoryArena::Lease arena)
+    : m_root(root)
+    , m_memoryLimit(memoryLimit)
+    , m_arena(std::move(arena))
+    , m_transpositionCount(static_cast<uint32_t>(std::bit_floor(std::max<size_t>(
+          memoryLimit / (sizeof(Node) * kNodesPerTransposition), kMinTranspositions))))
+    , m_capacity((memoryLimit - m_transpositionCount * sizeof(Transposition) -
+                  sizeof(uint32_t)) /
+                 (sizeof(Node) + sizeof(uint32_t)))
+{
+    m_transpositions = static_cast<Transposition*>(m_arena->allocate(
+        m_transpositionCount * sizeof(Transposition), alignof(Transposition)));
+    for (auto i = 0u; i < m_transpositionCount; i++)
+    {
+        new (&m_transpositions[i]) Transposition;
+    }
+    m_nodes = static_cast<Node*>(m_arena->allocate(m_capacity * sizeof(Node), alignof(Node)));
+    m_scratch = static_cast<uint32_t*>(
+        m_arena->allocate((m_capacity + 1) * sizeof(uint32_t), alignof(uint32_t)));
+
+    // The root is always the first node
+    new (&m_nodes[0]) Node;
+    m_used = 1;
+}
+
+uint64_t
+SearchTree::run(std::chrono::steady_clock::time_point deadline,
+                uint64_t playouts,
+                Board::ThreadMemory& memory,
+                std::stop_token stop)
+{
+    TAFL_TRACE_SCOPE(Search);
+
+    {
+        std::lock_guard lock(m_recycleMutex);
+        m_threads++;
+    }
+
+    uint64_t done = 0;
+    while (done < playouts && std::chrono::steady_clock::now() < deadline &&
+           !stop.stop_requested() &&
+           m_nodes[0].outcome.load(std::memory_order_relaxed) == Outcome::Unknown)
+    {
+        if (m_recycleRequested.load(std::memory_order_acquire))
+        {
+            waitForRecycling();
+            continue;
+        }
+
+        iterate(memory);
+        done++;
+    }
+
+    std::lock_guard lock(m_recycleMutex);
+    m_threads--;
+
+    // The other threads might all be waiting for this one
+    if (m_threads > 0 && m_parkedThreads == m_threads &&
+        m_recycleRequested.load(std::memory_order_relaxed))
+    {
+        recycle();
+        m_recycleDone.notify_all();
+    }
+
+    return done;
+}
+
+void
+SearchTree::iterate(Board::ThreadMemory& memory)
+{
+    std::array<Node*, kMaxDepth> path;
+    std::array<uint64_t, kMaxDepth> hashes;
+    auto depth = 0u;
+    auto board = m_root;
+    auto node = &m_nodes[0];
+
+    path[depth] = node;
+    hashes[depth++] = board.hash();
+
+    // The symmetry from the board to the canonical board the moves of the node are for
+    auto frame = 0u;
+
+    // Selection
+    while (depth < kMaxDepth && node->state.load(std::memory_order_acquire) == State::Expanded)
+    {
+        // Stop at a position the proof-number search just proved
+        consultOracle(*node, board);
+        if (node->outcome.load(std::memory_order_relaxed) != Outcome::Unknown)
+        {
+            break;
+        }
+
+        auto child = selectChild(*node);
+        if (!child)
+        {
+            break;
+        }
+
+        frame = Board::compose(frame, node->symmetry);
+        board.move(toMove(*child, frame));
+        node = child;
+        path[depth] = node;
+        hashes[depth++] = board.hash();
+
+        // Don't follow cycles, a repeated position is played out from here
+        if (std::find(hashes.begin(), hashes.begin() + depth - 1, board.hash()) !=
+            hashes.begin() + depth - 1)
+        {
+            break;
+        }
+    }
+
+    // The player who moved into the node
+    const auto mover = !board.getTurn();
+    Board::PlayResult result;
+
+    if (auto winner = board.getWinner())
+    {
+        node->outcome.store(*winner == mover ? Outcome::Win : Outcome::Loss,
+                            std::memory_order_relaxed);
+    }
+    else if (auto known = board.probeTablebase())
+    {
+        node->outcome.store(known->winner == mover ? Outcome::Win : Outcome::Loss,
+                            std::memory_order_relaxed);
+    }
+    else
+    {
+        proveFromChildren(*node);
+    }
+
+    // Expansion and playout, unless the result is already known
+    if (auto outcome = node->outcome.load(std::memory_order_relaxed); outcome != Outcome::Unknown)
+    {
+        result = Board::PlayResult(outcome == Outcome::Win ? mover : !mover, depth);
+    }
+    else
+    {
+        auto expected = State::Unexpanded;
+
+        if ((depth == 1 || node->visits.load(std::memory_order_relaxed) + 1 >= kExpansionVisits) &&
+            node->state.compare_exchange_strong(expected, State::Expanding))
+        {
+            if (!expand(*node, board, frame))
+            {
+                node->state.store(State::Unexpanded, std::memory_order_release);
+                m_recycleRequested.store(true, std::memory_order_release);
+            }
+        }
+
+        result = board.simulate(memory, depth);
+    }
+
+    // Backpropagation, where each node is rewarded for the player who moved into it
+    auto player = m_root.getTurn();
+    path[0]->visits.fetch_add(1, std::memory_order_relaxed);
+    for (auto i = 1u; i < depth; i++)
+    {
+        auto& cur = *path[i];
+
+        cur.reward.fetch_add(result.winRate(player), std::memory_order_relaxed);
+        cur.visits.fetch_add(1, std::memory_order_relaxed);
+        cur.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+        player = !player;
+    }
+
+    // Propagate proven results towards the root
+    for (auto i = depth - 1;
+         i > 0 && path[i]->outcome.load(std::memory_order_relaxed) != Outcome::Unknown;
+         i--)
+    {
+        proveFromChildren(*path[i - 1]);
+    }
+}
+
+SearchTree::Node*
+SearchTree::selectChild(Node& parent) const
+{
+    auto parentVisits = parent.visits.load(std::memory_order_relaxed);
+    auto logVisits = std::log(static_cast<float>(parentVisits + 1));
+    auto bestScore = -std::numeric_limits<float>::infinity();
+    auto children = &m_nodes[parent.firstChild];
+    Node* best = nullptr;
+
+    for (auto i = 0u; i < parent.childCount; i++)
+    {
+        auto& child = children[i];
+        auto outcome = child.outcome.load(std::memory_order_relaxed);
+
+        if (outcome == Outcome::Win)
+        {
+            best = &child;
+            break;
+        }
+        if (outcome == Outcome::Loss)
+        {
+            // Never worth playing
+            continue;
+        }
+
+        // Virtual losses count as visits without reward
+        auto n = child.visits.load(std::memory_order_relaxed) +
+                 child.virtualLoss.load(std::memory_order_relaxed);
+        if (n == 0)
+        {
+            best = &child;
+            break;
+        }
+
+        auto score = child.reward.load(std::memory_order_relaxed) / n +
+                     kExploration * std::sqrt(logVisits / n);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = &child;
+        }
+    }
+
+    if (best)
+    {
+        best->virtualLoss.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return best;
+}
+
+bool
+SearchTree::expand(Node& node, const Board& board, unsigned frame)
+{
+    const auto dim = board.getBoardDimension();
+    const auto hashes = board.symmetricHashes();
+    const auto canonical = std::ranges::min_element(hashes);
+    const auto symmetry = static_cast<unsigned>(canonical - hashes.begin());
+
+    node.symmetry = static_cast<uint8_t>(Board::compose(Board::inverse(frame), symmetry));
+
+    // Of the moves which lead to the same position up to a symmetry, only one is searched
+    auto isDistinct = [dim, &hashes](const Move& move) {
+        auto key = [dim](const Move& m) {
+            return std::pair {m.from.flatten(dim), m.to.flatten(dim)};
+        };
+
+        for (auto s = 1u; s < Board::kSymmetries; s++)
+        {
+            if (hashes[s] == hashes[0] && key(Board::transform(move, s, dim)) < key(move))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    auto count = 0u;
+    board.forEachPossibleMove([&count, &isDistinct](const Move& move) {
+        count += isDistinct(move) ? 1 : 0;
+    });
+
+    // Share the children if the position, or a symmetric one, has been reached through
+    // another path
+    auto transposition = findTransposition(*canonical);
+    if (transposition && transposition->second == count)
+    {
+        node.firstChild = transposition->first;
+        node.childCount = count;
+        node.state.store(State::Expanded, std::memory_order_release);
+        m_sharedExpansions.fetch_add(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    auto first = m_used.fetch_add(count, std::memory_order_relaxed);
+    if (first + count > m_capacity)
+    {
+        return false;
+    }
+
+    // The moves are stored for the canonical position, so that they can be shared
+    auto next = first;
+    board.forEachPossibleMove([this, dim, symmetry, &isDistinct, &next](const Move& move) {
+        if (!isDistinct(move))
+        {
+            return;
+        }
+
+        auto child = new (&m_nodes[next++]) Node;
+        auto canonicalMove = Board::transform(move, symmetry, dim);
+
+        child->from = canonicalMove.from.flatten(dim);
+        child->to = canonicalMove.to.flatten(dim);
+    });
+    node.firstChild = first;
+    node.childCount = count;
+
+    // Publish the children to the other threads
+    insertTransposition(*canonical, first, count);
+    node.state.store(State::Expanded, std::memory_order_release);
+
+    return true;
+}
+
+void
+SearchTree::proveFromChildren(Node& node) const
+{
+    if (node.state.load(std::memory_order_acquire) != State::Expanded || node.childCount == 0 ||
+        node.outcome.load(std::memory_order_relaxed) != Outcome::Unknown)
+    {
+        return;
+    }
+
+    auto children = &m_nodes[node.firstChild];
+    auto allLose = true;
+    for (auto i = 0u; i < node.childCount; i++)
+    {
+        auto outcome = children[i].outcome.load(std::memory_order_relaxed);
+
+        if (outcome == Outcome::Win)
+        {
+            // The opponent has a winning reply
+            node.outcome.store(Outcome::Loss, std::memory_order_relaxed);
+            return;
+        }
+        allLose = allLose && outcome == Outcome::Loss;
+    }
+
+    if (allLose)
+    {
+        node.outcome.store(Outcome::Win, std::memory_order_relaxed);
+    }
+}
+
+void
+SearchTree::consultOracle(Node& node, const Board& board)
+{
+    if (node.visits.load(std::memory_order_relaxed) < kOracleVisits ||
+        node.state.load(std::memory_order_acquire) != State::Expanded ||
+        node.outcome.load(std::memory_order_relaxed) != Outcome::Unknown ||
+        node.oracleChecked.exchange(true, std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    ProofConfig config;
+    config.attacker = board.getTurn();
+    config.moves = kOracleMoves;
+    config.nodeLimit = kOracleNodes;
+
+    auto result = ProofNumberSearch(config).run(board);
+    if (result.proof != Proof::Proven || !result.move)
+    {
+        return;
+    }
+
+    if (auto child = findChild(node, board, *result.move))
+    {
+        child->outcome.store(Outcome::Win, std::memory_order_relaxed);
+        proveFromChildren(node);
+    }
+}
+
+SearchTree::Node*
+SearchTree::findChild(const Node& node, const Board& board, const Move& move) const
+{
+    const auto dim = board.getBoardDimension();
+    const auto hashes = board.symmetricHashes();
+    const auto canonical = *std::ranges::min_element(hashes);
+    auto children = &m_nodes[node.firstChild];
+
+    // Any symmetry which gives the canonical position, as the move might have been merged
+    // with a symmetric one
+    for (auto s = 0u; s < Board::kSymmetries; s++)
+    {
+        if (hashes[s] != canonical)
+        {
+            continue;
+        }
+
+        auto image = Board::transform(move, s, dim);
+        for (auto i = 0u; i < node.childCount; i++)
+        {
+            if (children[i].from == image.from.flatten(dim) &&
+                children[i].to == image.to.flatten(dim))
+            {
+                return &children[i];
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+std::optional<std::pair<uint32_t, uint16_t>>
+SearchTree::findTransposition(uint64_t hash) const
+{
+    TAFL_TRACE_SCOPE(HashProbe);
+
+    // 0 marks free entries
+    const auto key = hash | 1;
+
+    for (auto i = 0u; i < kTranspositionProbes; i++)
+    {
+        auto& entry = m_transpositions[(key + i) & (m_transpositionCount - 1)];
+        auto entryHash = entry.hash.load(std::memory_order_relaxed);
+
+        if (entryHash == 0)
+        {
+            break;
+        }
+        if (entryHash == key)
+        {
+            auto children = entry.children.load(std::memory_order_acquire);
+            if (children == 0)
+            {
+                // Still being expanded by another thread
+                break;
+            }
+
+            TAFL_TRACE_COUNT(TranspositionHits, 1);
+            return std::pair {static_cast<uint32_t>(children),
+                              static_cast<uint16_t>(children >> 32)};
+        }
+    }
+
+    TAFL_TRACE_COUNT(TranspositionMisses, 1);
+    return std::nullopt;
+}
+
+void
+SearchTree::insertTransposition(uint64_t hash, uint32_t firstChild, uint16_t childCount)
+{
+    TAFL_TRACE_SCOPE(HashProbe);
+
+    const auto key = hash | 1;
+
+    // Lossy: the position is simply not shared if the probed entries are taken
+    for (auto i = 0u; i < kTranspositionProbes; i++)
+    {
+        auto& entry = m_transpositions[(key + i) & (m_transpositionCount - 1)];
+        auto expected = uint64_t {0};
+
+        if (entry.hash.compare_exchange_strong(expected, key, std::memory_order_relaxed))
+        {
+            entry.children.store(firstChild | static_cast<uint64_t>(childCount) << 32,
+                                 std::memory_order_release);
+            return;
+        }
+        if (expected == key)
+        {
+            // Expanded through another path at the same time
+            return;
+        }
+    }
+}
+
+Move
+SearchTree::toMove(const Node& node, unsigned symmetry) const
+{
+    const auto dim = m_root.getBoardDimension();
+    auto move = Move {{node.from % dim, node.from / dim}, {node.to % dim, node.to / dim}};
+
+    return Board::transform(move, Board::inverse(symmetry), dim);
+}
+
+void
+SearchTree::waitForRecycling()
+{
+    std::unique_lock lock(m_recycleMutex);
+
+    if (!m_recycleRequested.load(std::memory_order_relaxed))
+    {
+        // Already done by another thread
+        return;
+    }
+
+    m_parkedThreads++;
+    if (m_parkedThreads == m_threads)
+    {
+        recycle();
+        m_recycleDone.notify_all();
+        return;
+    }
+
+    auto recycles = m_recycles;
+    m_recycleDone.wait(lock, [this, recycles]() { return m_recycles != recycles; });
+}
+
+void
+SearchTree::recycle()
+{
+    // No thread is in the tree now. Find the expanded nodes...
+    auto nodes = std::span(m_scratch, collect(0));
+    auto leaves = std::ranges::remove_if(nodes, [this](uint32_t i) {
+        return m_nodes[i].state.load(std::memory_order_relaxed) != State::Expanded;
+    });
+    auto expanded = std::span(nodes.begin(), leaves.begin());
+
+    // ... and keep the children of the most visited ones, within half of the arena. Shared
+    // children are counted once per parent, which only leaves more room.
+    std::ranges::sort(expanded, [this](uint32_t a, uint32_t b) {
+        auto visitsA = m_nodes[a].visits.load(std::memory_order_relaxed);
+        auto visitsB = m_nodes[b].visits.load(std::memory_order_relaxed);
+
+        return visitsA != visitsB ? visitsA > visitsB
+                                  : m_nodes[a].childCount > m_nodes[b].childCount;
+    });
+
+    auto kept = 1u;
+    auto threshold = 0u;
+    for (auto i : expanded)
+    {
+        auto childCount = m_nodes[i].childCount;
+
+        if (kept + childCount > m_capacity / 2 && kept > 1)
+        {
+            threshold = m_nodes[i].visits.load(std::memory_order_relaxed) + 1;
+            break;
+        }
+        kept += childCount;
+    }
+
+    // Compact, collapsing the recycled subtrees into leaves
+    compact(0, threshold, kept);
+
+    m_parkedThreads = 0;
+    m_recycles++;
+    m_recycleRequested.store(false, std::memory_order_release);
+}
+
+uint32_t
+SearchTree::collect(uint32_t root)
+{
+    auto hasChildren = [](const Node& node) {
+        return node.state.load(std::memory_order_relaxed) == State::Expanded &&
+               node.childCount > 0;
+    };
+    auto count = 1u;
+
+    // The first child of each block is marked once the block is queued
+    m_scratch[0] = root;
+    for (auto i = 0u; i < count; i++)
+    {
+        auto& node = m_nodes[m_scratch[i]];
+
+        if (hasChildren(node) &&
+            m_nodes[node.firstChild].virtualLoss.exchange(1, std::memory_order_relaxed) == 0)
+        {
+            for (auto c = 0u; c < node.childCount; c++)
+            {
+                m_scratch[count++] = node.firstChild + c;
+            }
+        }
+    }
+
+    for (auto i = 0u; i < count; i++)
+    {
+        if (auto& node = m_nodes[m_scratch[i]]; hasChildren(node))
+        {
+            m_nodes[node.firstChild].virtualLoss.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    return count;
+}
+
+void
+SearchTree::compact(uint32_t root, uint32_t threshold, uint32_t limit)
+{
+    const auto end = std::min(m_used.load(std::memory_order_relaxed), m_capacity);
+    auto isMarked = [this](uint32_t i) {
+        return m_nodes[i].virtualLoss.load(std::memory_order_relaxed) != 0;
+    };
+
+    // Choose the kept children breadth-first and mark them, and collapse the nodes whose
+    // children aren't kept into leaves. A block holding the root isn't kept, since the
+    // root moves to the front.
+    auto queued = 1u;
+    auto used = 1u;
+    m_scratch[0] = root;
+    for (auto i = 0u; i < queued; i++)
+    {
+        auto& node = m_nodes[m_scratch[i]];
+        const auto first = node.firstChild;
+        const auto expanded = node.state.load(std::memory_order_relaxed) == State::Expanded;
+        const auto shared = expanded && node.childCount > 0 && isMarked(first);
+
+        if (!expanded || (i != 0 && node.visits.load(std::memory_order_relaxed) < threshold) ||
+            (!shared && (used + node.childCount > limit ||
+                         (first <= root && root < first + node.childCount))))
+        {
+            node.state.store(State::Unexpanded, std::memory_order_relaxed);
+            node.childCount = 0;
+            node.firstChild = kNoChildren;
+            continue;
+        }
+
+        if (shared)
+        {
+            // Already kept through another parent
+            continue;
+        }
+
+        for (auto c = 0u; c < node.childCount; c++)
+        {
+            m_nodes[first + c].virtualLoss.store(1, std::memory_order_relaxed);
+            m_scratch[queued++] = first + c;
+        }
+        used += node.childCount;
+    }
+
+    // The kept nodes keep their order behind the root, so that each moves towards the
+    // front. The root takes the first node, which is either itself or the old root.
+    auto next = 1u;
+    for (auto i = 0u; i < end; i++)
+    {
+        if (isMarked(i))
+        {
+            m_scratch[i] = next++;
+        }
+    }
+    m_scratch[root] = 0;
+
+    auto relink = [this](Node& node) {
+        if (node.state.load(std::memory_order_relaxed) == State::Expanded &&
+            node.childCount > 0)
+        {
+            node.firstChild = m_scratch[node.firstChild];
+        }
+    };
+    relink(m_nodes[root]);
+    for (auto i = 0u; i < end; i++)
+    {
+        if (isMarked(i))
+        {
+            relink(m_nodes[i]);
+        }
+    }
+
+    // Keep the transpositions of the kept children
+    for (auto i = 0u; i < m_transpositionCount; i++)
+    {
+        auto& entry = m_transpositions[i];
+        auto children = entry.children.load(std::memory_order_relaxed);
+        auto first = static_cast<uint32_t>(children);
+
+        if (children != 0 && first < end && isMarked(first))
+        {
+            entry.children.store(m_scratch[first] | (children >> 32) << 32,
+                                 std::memory_order_relaxed);
+        }
+        else
+        {
+            entry.hash.store(0, std::memory_order_relaxed);
+            entry.children.store(0, std::memory_order_relaxed);
+        }
+    }
+    settleTranspositions();
+
+    if (root != 0)
+    {
+        copyNode(*new (&m_nodes[0]) Node, m_nodes[root]);
+    }
+    for (auto i = 1u; i < end; i++)
+    {
+        if (isMarked(i))
+        {
+            auto to = m_scratch[i];
+
+            if (to != i)
+            {
+                copyNode(*new (&m_nodes[to]) Node, m_nodes[i]);
+            }
+            m_nodes[to].virtualLoss.store(0, std::memory_order_relaxed);
+        }
+    }
+    m_used.store(next, std::memory_order_relaxed);
+}
+
+void
+SearchTree::settleTranspositions()
+{
+    const auto mask = m_transpositionCount - 1;
+
+    // A free entry ends the probes, so an entry behind one which was freed is moved to
+    // it. Moving an entry can free one for another, so repeat until nothing moves.
+    for (auto moved = true; moved;)
+    {
+        moved = false;
+        for (auto i = 0u; i < m_transpositionCount; i++)
+        {
+            auto& entry = m_transpositions[i];
+            auto key = entry.hash.load(std::memory_order_relaxed);
+
+            for (auto probe = 0u; key != 0 && probe < kTranspositionProbes; probe++)
+            {
+                auto& to = m_transpositions[(key + probe) & mask];
+
+                if (&to == &entry)
+                {
+                    break;
+                }
+                if (to.hash.load(std::memory_order_relaxed) == 0)
+                {
+                    to.hash.store(key, std::memory_order_relaxed);
+                    to.children.store(entry.children.load(std::memory_order_relaxed),
+                                      std::memory_order_relaxed);
+                    entry.hash.store(0, std::memory_order_relaxed);
+                    entry.children.store(0, std::memory_order_relaxed);
+                    moved = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool
+SearchTree::advance(std::span<const Move> moves)
+{
+    auto board = m_root;
+    auto root = 0u;
+
+    for (auto& move : moves)
+    {
+        auto& node = m_nodes[root];
+        if (node.state.load(std::memory_order_relaxed) != State::Expanded)
+        {
+            return false;
+        }
+
+        // The subtree of a symmetric move is as good, the children being canonical
+        auto child = findChild(node, board, move);
+        if (!child)
+        {
+            return false;
+        }
+
+        root = static_cast<uint32_t>(child - m_nodes);
+        board.move(move);
+    }
+
+    if (root != 0)
+    {
+        compact(root, 0, collect(root));
+    }
+
+    for (auto& move : moves)
+    {
+        m_root.move(move);
+    }
+
+    // The root has no parent, so its moves are for its own canonical board
+    m_nodes[0].symmetry = static_cast<uint8_t>(m_root.canonicalHash().second);
+
+    return true;
+}
+
+const Board&
+SearchTree::getRoot() const
+{
+    return m_root;
+}
+
+uint32_t
+SearchTree::getRootVisits() const
+{
+    return m_nodes[0].visits.load(std::memory_order_relaxed);
+}
+
+size_t
+SearchTree::getMemoryLimit() const
+{
+    return m_memoryLimit;
+}
+
+void
+SearchTree::copyNode(Node& dst, const Node& src) const
+{
+    dst.from = src.from;
+    dst.to = src.to;
+    dst.visits.store(src.visits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    dst.reward.store(src.reward.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    dst.virtualLoss.store(src.virtualLoss.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    dst.state.store(src.state.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    dst.outcome.store(src.outcome.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    dst.oracleChecked.store(src.oracleChecked.load(std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+    dst.childCount = src.childCount;
+    dst.symmetry = src.symmetry;
+    dst.firstChild = src.firstChild;
+}
+
+std::vector<MoveStatistics>
+SearchTree::getRootStatistics() const
+{
+    TAFL_TRACE_SCOPE(Aggregation);
+
+    auto out = collectRootStatistics();
+    sortStatistics(out);
+
+    return out;
+}
+
+std::vector<MoveStatistics>
+SearchTree::mergeRootStatistics(const std::vector<std::shared_ptr<SearchTree>>& trees)
+{
+    TAFL_TRACE_SCOPE(Aggregation);
+
+    std::vector<MoveStatistics> out;
+
+    for (auto& tree : trees)
+    {
+        addStatistics(out, tree->collectRootStatistics());
+    }
+
+    sortStatistics(out);
+
+    return out;
+}
+
+SearchProgress
+SearchTree::getProgress(const std::vector<std::shared_ptr<SearchTree>>& trees,
+                        unsigned variations)
+{
+    TAFL_TRACE_SCOPE(Aggregation);
+
+    SearchProgress out;
+    const SearchTree* deepest = nullptr;
+
+    for (auto& tree : trees)
+    {
+        std::lock_guard lock(tree->m_recycleMutex);
+
+        addStatistics(out.moves, tree->collectRootStatistics());
+        if (!deepest || tree->getRootVisits() > deepest->getRootVisits())
+        {
+            deepest = tree.get();
+        }
+    }
+    sortStatistics(out.moves);
+    if (out.moves.empty())
+    {
+        return out;
+    }
+    out.bestMove = out.moves.front().move;
+
+    // The lines of the most searched tree
+    std::lock_guard lock(deepest->m_recycleMutex);
+    for (auto i = 0u; i < std::min<size_t>(variations, out.moves.size()); i++)
+    {
+        out.principalVariations.push_back(deepest->getPrincipalVariation(out.moves[i].move));
+    }
+
+    return out;
+}
+
+std::vector<MoveStatistics>
+SearchTree::collectRootStatistics() const
+{
+    std::vector<MoveStatistics> out;
+    auto& root = m_nodes[0];
+
+    if (root.state.load(std::memory_order_acquire) != State::Expanded)
+    {
+        return out;
+    }
+
+    // Symmetric moves were searched as one, and share the statistics
+    m_root.forEachPossibleMove([this, &root, &out](const Move& move) {
+        auto child = findChild(root, m_root, move);
+        if (!child)
+        {
+            return;
+        }
+
+        auto visits = child->visits.load(std::memory_order_relaxed);
+        out.push_back({move,
+                       visits,
+                       visits ? child->reward.load(std::memory_order_relaxed) / visits : 0.0f,
+                       child->outcome.load(std::memory_order_relaxed)});
+    });
+
+    return out;
+}
+
+void
+SearchTree::addStatistics(std::vector<MoveStatistics>& out, std::vector<MoveStatistics> statistics)
+{
+    if (statistics.empty())
+    {
+        return;
+    }
+    if (out.empty())
+    {
+        out = std::move(statistics);
+        return;
+    }
+
+    // The same root, so the moves are in the same order
+    for (auto i = 0u; i < out.size(); i++)
+    {
+        auto& merged = out[i];
+        auto& other = statistics[i];
+        auto visits = merged.visits + other.visits;
+
+        merged.winRate =
+            visits ? (merged.winRate * merged.visits + other.winRate * other.visits) / visits
+                   : 0.0f;
+        merged.visits = visits;
+
+        // Proofs hold in every tree
+        if (other.outcome != Outcome::Unknown)
+        {
+            merged.outcome = other.outcome;
+        }
+    }
+}
+
+void
+SearchTree::sortStatistics(std::vector<MoveStatistics>& statistics)
+{
+    std::ranges::sort(statistics, [](const MoveStatistics& a, const MoveStatistics& b) {
+        // Wins first and losses last, regardless of the visits
+        auto rank = [](Outcome outcome) {
+            return outcome == Outcome::Win ? 0 : outcome == Outcome::Unknown ? 1 : 2;
+        };
+        if (rank(a.outcome) != rank(b.outcome))
+        {
+            return rank(a.outcome) < rank(b.outcome);
+        }
+        if (a.visits != b.visits)
+        {
+            return a.visits > b.visits;
+        }
+
+        return a.winRate > b.winRate;
+    });
+}
+
+std::vector<Move>
+SearchTree::getPrincipalVariation(const Move& move) const
+{
+    std::vector<Move> out {move};
+    auto board = m_root;
+    auto node = findChild(m_nodes[0], board, move);
+
+    board.move(move);
+    while (node && out.size() < kMaxVariationLength &&
+           node->state.load(std::memory_order_acquire) == State::Expanded)
+    {
+        auto children = std::span(&m_nodes[node->firstChild], node->childCount);
+        auto best = std::ranges::max_element(children, [](const Node& a, const Node& b) {
+            return a.visits.load(std::memory_order_relaxed) <
+                   b.visits.load(std::memory_order_relaxed);
+        });
+        if (best == children.end() || best->visits.load(std::memory_order_relaxed) == 0)
+        {
+            break;
+        }
+
+        // The children are for the canonical board, which any of these symmetries gives
+        auto hashes = board.symmetricHashes();
+        auto symmetry = std::ranges::min_element(hashes) - hashes.begin();
+
+        out.push_back(toMove(*best, static_cast<unsigned>(symmetry)));
+        board.move(out.back());
+        node = &*best;
+    }
+
+    return out;
+}
+
+unsigned
+SearchTree::getRecycleCount() const
+{
+    return m_recycles;
+}
+
+uint64_t
+SearchTree::getTranspositionCount() const
+{
+    return m_sharedExpansions.load(std::memory_order_relaxed);
+}
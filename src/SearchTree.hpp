@@ -0,0 +1,263 @@
+#pragma once
+
+#include "Board.hpp"
+
+#include <MemoryArena.hpp>
+#include <SearchConfig.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+
+namespace tafl
+{
+
+/*
+ * A Monte Carlo search tree, shared between the search threads.
+ *
+ * Node statistics are updated atomically and nodes are expanded lock-free by the
+ * first thread which reaches them. Threads which pass a node add a virtual loss to
+ * it until their playout is finished, so that concurrent threads spread out over
+ * different branches.
+ *
+ * The nodes are kept in a fixed-size arena from the pool of MemoryArena, with the
+ * children of a node stored contiguously. When the arena is full, the searching
+ * threads pause while the least visited subtrees are recycled and the tree is
+ * compacted in place, without allocating.
+ *
+ * Positions reached through different move orders share their children, which are
+ * found through a table keyed by the Zobrist hash of the position. The tree is thus
+ * a graph, with cycles when a position repeats. A playout which reaches a position
+ * already on its path stops selecting there.
+ *
+ * Positions which are rotations or mirrors of each other are shared too, with the
+ * moves of the children stored for the canonical one of the symmetric positions. Of
+ * the moves of a symmetric position which lead to the same position up to its
+ * symmetries, such as most opening moves, only one is searched.
+ *
+ * Results which are certain are proven and propagated up the tree: a position where a
+ * move wins is lost for the player moving into it, and one where all moves lose is won.
+ * Moves which are proven to lose are not selected, and the search stops once the root
+ * is proven. Positions which are visited often are also checked for short forced wins
+ * with a proof-number search.
+ *
+ * The tree is kept between searches, and can be advanced along the moves played
+ * since the last search so that the next search continues from that subtree.
+ */
+class SearchTree
+{
+public:
+    // Create a tree, or return nullptr if its memory can't be allocated
+    static std::shared_ptr<SearchTree> create(const Board& root, size_t memoryLimit);
+
+    /**
+     * Search until the deadline. Can be called concurrently from several threads.
+     *
+     * @param deadline when to stop
+     * @param playouts the most playouts to make
+     * @param memory the search memory of the calling thread
+     * @param stop to stop before the deadline
+     *
+     * @return the number of playouts made by this thread
+     */
+    uint64_t run(std::chrono::steady_clock::time_point deadline,
+                 uint64_t playouts,
+                 Board::ThreadMemory& memory,
+                 std::stop_token stop = {});
+
+    /**
+     * Move the root along the played moves, keeping the subtree below it. Must not be
+     * called while the tree is searched.
+     *
+     * @param moves the moves played from the current root
+     *
+     * @return true if the subtree was found, false otherwise
+     */
+    bool advance(std::span<const Move> moves);
+
+    // The position at the root of the tree
+    const Board& getRoot() const;
+
+    // The number of playouts through the root
+    uint32_t getRootVisits() const;
+
+    size_t getMemoryLimit() const;
+
+    // The statistics for the root moves, in the order of SearchResult::moves
+    std::vector<MoveStatistics> getRootStatistics() const;
+
+    // The statistics for the root moves of trees with the same root, added in order
+    static std::vector<MoveStatistics>
+    mergeRootStatistics(const std::vector<std::shared_ptr<SearchTree>>& trees);
+
+    /**
+     * The statistics for the root moves and the principal variations of the best ones,
+     * while the trees are searched. Recycling waits for it, but the searching doesn't.
+     *
+     * @param trees trees with the same root, merged as by mergeRootStatistics()
+     * @param variations the number of best moves to follow
+     *
+     * @return the progress, without the playouts and the time
+     */
+    static SearchProgress getProgress(const std::vector<std::shared_ptr<SearchTree>>& trees,
+                                      unsigned variations);
+
+    // The number of times subtrees have been recycled
+    unsigned getRecycleCount() const;
+
+    // The number of nodes which share the children of a transposed position
+    uint64_t getTranspositionCount() const;
+
+private:
+    static constexpr auto kMaxDepth = 128u;
+    static constexpr float kExploration = 1.0f;
+    // Leaves are expanded after this many visits
+    static constexpr auto kExpansionVisits = 4u;
+    static constexpr auto kNoChildren = 0u;
+    // Positions are checked for forced wins within a few moves after this many visits
+    static constexpr auto kOracleVisits = 256u;
+    static constexpr auto kOracleMoves = 2u;
+    static constexpr auto kOracleNodes = 2000u;
+    static constexpr auto kMaxVariationLength = 16u;
+
+    enum class State : uint8_t
+    {
+        Unexpanded,
+        Expanding,
+        Expanded,
+    };
+
+    struct Node
+    {
+        // The move leading to this node, as flattened positions
+        uint16_t from {0};
+        uint16_t to {0};
+
+        std::atomic<uint32_t> visits {0};
+        // The sum of the rewards for the player who made the move
+        std::atomic<float> reward {0};
+        std::atomic<uint16_t> virtualLoss {0};
+
+        std::atomic<State> state {State::Unexpanded};
+        // For the player who made the move
+        std::atomic<Outcome> outcome {Outcome::Unknown};
+
+        // Only valid once the state is Expanded
+        uint16_t childCount {0};
+        std::atomic<bool> oracleChecked {false};
+        // Once expanded, the symmetry from the position after the move, on the canonical
+        // board of the parent, to the canonical board of this node
+        uint8_t symmetry {0};
+        uint32_t firstChild {kNoChildren};
+    };
+
+    static_assert(sizeof(Node) <= 24);
+
+    // An entry in the transposition table, from a position hash to its children
+    struct Transposition
+    {
+        std::atomic<uint64_t> hash {0};
+        // The first child and the child count, or 0 until published
+        std::atomic<uint64_t> children {0};
+    };
+
+    // The transposition table takes this share of the tree memory
+    static constexpr auto kNodesPerTransposition = 8u;
+    static constexpr auto kTranspositionProbes = 4u;
+    static constexpr auto kMinTranspositions = 16u;
+    // Less can't hold the transposition table and the children of a position
+    static constexpr size_t kMinMemoryLimit = 16 * 1024;
+
+    SearchTree(const Board& root, size_t memoryLimit, MemoryArena::Lease arena);
+
+    void iterate(Board::ThreadMemory& memory);
+
+    Node* selectChild(Node& parent) const;
+
+    // Expand a node, reached with a move for the canonical board of the parent which
+    // is @a frame of the board
+    bool expand(Node& node, const Board& board, unsigned frame);
+
+    // Prove the outcome of an expanded node from its children, if possible
+    void proveFromChildren(Node& node) const;
+
+    // Prove a winning move from a node with a proof-number search, once the selection has
+    // passed it often enough
+    void consultOracle(Node& node, const Board& board);
+
+    // The move of a node, on a board which the canonical position is a symmetry of
+    Move toMove(const Node& node, unsigned symmetry) const;
+
+    // The child of an expanded node for a move on its board, or for a symmetric move
+    Node* findChild(const Node& node, const Board& board, const Move& move) const;
+
+    // The children of an expanded position, or std::nullopt if it's not known
+    std::optional<std::pair<uint32_t, uint16_t>> findTransposition(uint64_t hash) const;
+
+    void insertTransposition(uint64_t hash, uint32_t firstChild, uint16_t childCount);
+
+    // Park the calling thread while the tree is recycled by the last thread to park
+    void waitForRecycling();
+
+    void recycle();
+
+    /*
+     * Collect the nodes of the subtree at index root breadth-first into the scratch
+     * indices, the children shared by several nodes once, and return their number.
+     */
+    uint32_t collect(uint32_t root);
+
+    /*
+     * Compact the subtree at index root to the start of the arena, keeping at most limit
+     * nodes, chosen breadth-first. Nodes visited less than threshold are collapsed into
+     * leaves. Shared children are kept shared, and the transposition table is updated.
+     */
+    void compact(uint32_t root, uint32_t threshold, uint32_t limit);
+
+    // Move the entries of the transposition table to the first free entries they probe
+    void settleTranspositions();
+
+    void copyNode(Node& dst, const Node& src) const;
+
+    // The statistics for the root moves, in the order of the possible moves
+    std::vector<MoveStatistics> collectRootStatistics() const;
+
+    // Add the statistics for the same root moves, in the same order
+    static void addStatistics(std::vector<MoveStatistics>& out,
+                              std::vector<MoveStatistics> statistics);
+
+    static void sortStatistics(std::vector<MoveStatistics>& statistics);
+
+    // The most visited line of moves after a root move, starting with it
+    std::vector<Move> getPrincipalVariation(const Move& move) const;
+
+    Board m_root;
+
+    const size_t m_memoryLimit;
+    MemoryArena::Lease m_arena;
+    Transposition* m_transpositions;
+    const uint32_t m_transpositionCount;
+    Node* m_nodes;
+    const uint32_t m_capacity;
+    /*
+     * One index for each node and the root, for recycling. No thread is in the tree
+     * while it's recycled or advanced, so the virtual losses of the nodes are all 0 and
+     * mark the nodes instead.
+     */
+    uint32_t* m_scratch;
+    std::atomic<uint32_t> m_used {0};
+    std::atomic<uint64_t> m_sharedExpansions {0};
+
+    std::atomic<bool> m_recycleRequested {false};
+    // Also keeps the tree from being recycled while the progress is taken
+    mutable std::mutex m_recycleMutex;
+    std::condition_variable m_recycleDone;
+    unsigned m_threads {0};
+    unsigned m_parkedThreads {0};
+    unsigned m_recycles {0};
+};
+
+} // namespace tafl
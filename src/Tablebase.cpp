@@ -0,0 +1,657 @@
+#include "Tablebase.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace tafl;
+
+namespace
+{
+
+constexpr auto kMagic = std::array {'T', 'A', 'F', 'L', 'T', 'B', '1', '\0'};
+
+struct Header
+{
+    std::array<char, 8> magic;
+    uint32_t dimension;
+    uint32_t whites;
+    uint32_t blacks;
+    uint32_t reserved;
+    uint64_t entries;
+};
+
+// The positions in a generation pass are handed out to the threads in blocks of this size
+constexpr uint64_t kBlockSize = 4096;
+
+constexpr auto kBinomials = []() {
+    std::array<std::array<uint64_t, Tablebases::kMaxPieces + 1>, 65> out {};
+
+    for (auto n = 0u; n < out.size(); n++)
+    {
+        out[n][0] = 1;
+        for (auto k = 1u; k <= Tablebases::kMaxPieces; k++)
+        {
+            out[n][k] = n == 0 ? 0 : out[n - 1][k - 1] + out[n - 1][k];
+        }
+    }
+
+    return out;
+}();
+
+// The colexicographic rank of a set of squares among the sets of the same size
+uint64_t
+rank(uint64_t squares)
+{
+    uint64_t out = 0;
+
+    for (auto k = 1u; squares; squares &= squares - 1, k++)
+    {
+        out += kBinomials[std::countr_zero(squares)][k];
+    }
+
+    return out;
+}
+
+uint64_t
+unrank(uint64_t rank, unsigned count, unsigned squares)
+{
+    uint64_t out = 0;
+    auto square = squares;
+
+    for (auto k = count; k > 0; k--)
+    {
+        do
+        {
+            square--;
+        } while (kBinomials[square][k] > rank);
+
+        out |= uint64_t(1) << square;
+        rank -= kBinomials[square][k];
+    }
+
+    return out;
+}
+
+bool
+isOnEdge(unsigned square, unsigned dimension)
+{
+    auto x = square % dimension;
+    auto y = square / dimension;
+
+    return x == 0 || y == 0 || x == dimension - 1 || y == dimension - 1;
+}
+
+/*
+ * Remove the pieces of the player who didn't move which are captured, as in
+ * Board::scanCaptures(), and return true if the king was captured.
+ */
+bool
+capture(TablebasePosition& position, Color mover, unsigned dimension)
+{
+    const auto dim = static_cast<int>(dimension);
+    const auto castle = dimension / 2 * dimension + dimension / 2;
+    const auto hostile = mover == Color::White
+                             ? position.whites | (uint64_t(1) << position.king)
+                             : position.blacks;
+
+    auto isHostile = [dim, hostile](int x, int y) {
+        return x >= 0 && y >= 0 && x < dim && y < dim && (hostile >> (y * dim + x) & 1);
+    };
+    auto isCaptured = [dim, &isHostile](unsigned square, bool inCastle) {
+        auto x = static_cast<int>(square) % dim;
+        auto y = static_cast<int>(square) / dim;
+        auto vertical = isHostile(x, y - 1) && isHostile(x, y + 1);
+        auto horizontal = isHostile(x - 1, y) && isHostile(x + 1, y);
+
+        // The king in the castle must be surrounded on all 4 sides
+        return inCastle ? vertical && horizontal : vertical || horizontal;
+    };
+
+    auto& victims = mover == Color::White ? position.blacks : position.whites;
+    for (auto squares = victims; squares; squares &= squares - 1)
+    {
+        auto square = std::countr_zero(squares);
+
+        if (isCaptured(square, false))
+        {
+            victims &= ~(uint64_t(1) << square);
+        }
+    }
+
+    return mover == Color::Black && isCaptured(position.king, position.king == castle);
+}
+
+/*
+ * Invoke onChild for each move of the side to move, with the resulting position and
+ * the winner if the move ends the game.
+ */
+template <typename F>
+void
+forEachChild(const TablebasePosition& position, unsigned dimension, F&& onChild)
+{
+    const auto dim = static_cast<int>(dimension);
+    const auto castle = dimension / 2 * dimension + dimension / 2;
+
+    // Nothing can move to or pass the castle
+    const auto blocked = position.whites | position.blacks | (uint64_t(1) << position.king) |
+                         (uint64_t(1) << castle);
+
+    auto moveFrom = [&](unsigned from, uint64_t TablebasePosition::*pieces) {
+        constexpr std::array<std::pair<int, int>, 4> kDirections {
+            {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+
+        for (auto [dx, dy] : kDirections)
+        {
+            for (auto x = static_cast<int>(from) % dim + dx, y = static_cast<int>(from) / dim + dy;
+                 x >= 0 && y >= 0 && x < dim && y < dim;
+                 x += dx, y += dy)
+            {
+                auto to = static_cast<unsigned>(y * dim + x);
+                if (blocked >> to & 1)
+                {
+                    break;
+                }
+
+                auto child = position;
+                if (pieces)
+                {
+                    child.*pieces ^= (uint64_t(1) << from) | (uint64_t(1) << to);
+                }
+                else
+                {
+                    child.king = to;
+                }
+                child.turn = !position.turn;
+
+                std::optional<Color> winner;
+                if (capture(child, position.turn, dimension))
+                {
+                    winner = Color::Black;
+                }
+                else if (isOnEdge(child.king, dimension))
+                {
+                    winner = Color::White;
+                }
+                onChild(child, winner);
+            }
+        }
+    };
+
+    if (position.turn == Color::White)
+    {
+        moveFrom(position.king, nullptr);
+        for (auto squares = position.whites; squares; squares &= squares - 1)
+        {
+            moveFrom(std::countr_zero(squares), &TablebasePosition::whites);
+        }
+    }
+    else
+    {
+        for (auto squares = position.blacks; squares; squares &= squares - 1)
+        {
+            moveFrom(std::countr_zero(squares), &TablebasePosition::blacks);
+        }
+    }
+}
+
+std::filesystem::path
+tablebasePath(const std::string& directory, const TablebaseLayout& layout)
+{
+    return std::filesystem::path(directory) / fmt::format("tafl-{}x{}-{}w-{}b.tb",
+                                                          layout.getDimension(),
+                                                          layout.getDimension(),
+                                                          layout.getWhites(),
+                                                          layout.getBlacks());
+}
+
+} // namespace
+
+TablebaseLayout::TablebaseLayout(unsigned dimension, unsigned whites, unsigned blacks)
+    : m_dimension(dimension)
+    , m_whites(whites)
+    , m_blacks(blacks)
+    , m_squares(dimension * dimension)
+    , m_whiteSets(kBinomials[m_squares][whites])
+    , m_blackSets(kBinomials[m_squares][blacks])
+{
+    assert(dimension <= Tablebases::kMaxDimension);
+    assert(whites <= Tablebases::kMaxPieces && blacks <= Tablebases::kMaxPieces);
+}
+
+unsigned
+TablebaseLayout::getDimension() const
+{
+    return m_dimension;
+}
+
+unsigned
+TablebaseLayout::getWhites() const
+{
+    return m_whites;
+}
+
+unsigned
+TablebaseLayout::getBlacks() const
+{
+    return m_blacks;
+}
+
+uint64_t
+TablebaseLayout::size() const
+{
+    return m_squares * m_whiteSets * m_blackSets * 2;
+}
+
+uint64_t
+TablebaseLayout::index(const TablebasePosition& position) const
+{
+    auto out = (position.king * m_whiteSets + rank(position.whites)) * m_blackSets +
+               rank(position.blacks);
+
+    return out * 2 + (position.turn == Color::Black ? 1 : 0);
+}
+
+TablebasePosition
+TablebaseLayout::position(uint64_t index) const
+{
+    TablebasePosition out;
+
+    out.turn = index % 2 ? Color::Black : Color::White;
+    index /= 2;
+    out.blacks = unrank(index % m_blackSets, m_blacks, m_squares);
+    index /= m_blackSets;
+    out.whites = unrank(index % m_whiteSets, m_whites, m_squares);
+    out.king = static_cast<unsigned>(index / m_whiteSets);
+
+    return out;
+}
+
+bool
+TablebaseLayout::isValid(const TablebasePosition& position) const
+{
+    const auto castle = m_dimension / 2 * m_dimension + m_dimension / 2;
+    const auto pieces = position.whites | position.blacks;
+
+    return (position.whites & position.blacks) == 0 && !(pieces >> position.king & 1) &&
+           !(pieces >> castle & 1);
+}
+
+std::optional<TablebaseResult>
+TablebaseEntry::decode(uint8_t entry, Color turn)
+{
+    if (entry == kUnknown || entry == kInvalid)
+    {
+        return std::nullopt;
+    }
+
+    auto plies = static_cast<unsigned>(entry - 1);
+
+    return TablebaseResult {plies % 2 ? turn : !turn, plies};
+}
+
+TablebaseFile::TablebaseFile(const TablebaseLayout& layout, void* mapping, size_t size)
+    : m_layout(layout)
+    , m_mapping(mapping)
+    , m_size(size)
+    , m_entries(static_cast<const uint8_t*>(mapping) + sizeof(Header))
+{
+}
+
+TablebaseFile::~TablebaseFile()
+{
+    munmap(m_mapping, m_size);
+}
+
+std::unique_ptr<TablebaseFile>
+TablebaseFile::open(const std::string& path)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    auto mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    Header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (header.magic != kMagic || header.dimension < 3 ||
+        header.dimension > Tablebases::kMaxDimension || header.whites > Tablebases::kMaxPieces ||
+        header.blacks > Tablebases::kMaxPieces)
+    {
+        munmap(mapping, size);
+        return nullptr;
+    }
+
+    TablebaseLayout layout(header.dimension, header.whites, header.blacks);
+    if (header.entries != layout.size() || size != sizeof(Header) + layout.size())
+    {
+        munmap(mapping, size);
+        return nullptr;
+    }
+
+    return std::unique_ptr<TablebaseFile>(new TablebaseFile(layout, mapping, size));
+}
+
+bool
+TablebaseFile::write(const std::string& path,
+                     const TablebaseLayout& layout,
+                     const std::vector<uint8_t>& entries)
+{
+    Header header {kMagic,
+                   layout.getDimension(),
+                   layout.getWhites(),
+                   layout.getBlacks(),
+                   0,
+                   entries.size()};
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), entries.size());
+
+    return out.good();
+}
+
+std::vector<std::unique_ptr<TablebaseFile>>&
+TablebaseFile::loaded()
+{
+    static std::vector<std::unique_ptr<TablebaseFile>> files;
+
+    return files;
+}
+
+const TablebaseFile*
+TablebaseFile::find(unsigned dimension, unsigned whites, unsigned blacks)
+{
+    for (auto& file : loaded())
+    {
+        auto& layout = file->getLayout();
+
+        if (layout.getDimension() == dimension && layout.getWhites() == whites &&
+            layout.getBlacks() == blacks)
+        {
+            return file.get();
+        }
+    }
+
+    return nullptr;
+}
+
+const TablebaseLayout&
+TablebaseFile::getLayout() const
+{
+    return m_layout;
+}
+
+std::optional<TablebaseResult>
+TablebaseFile::probe(const TablebasePosition& position) const
+{
+    return TablebaseEntry::decode(m_entries[m_layout.index(position)], position.turn);
+}
+
+TablebaseGenerator::TablebaseGenerator(unsigned dimension, unsigned threads)
+    : m_dimension(dimension)
+    , m_threads(std::max(threads, 1u))
+{
+}
+
+const std::vector<uint8_t>&
+TablebaseGenerator::generate(unsigned whites, unsigned blacks)
+{
+    if (auto it = m_tables.find({whites, blacks}); it != m_tables.end())
+    {
+        return it->second.entries;
+    }
+
+    // Captures lead to the smaller tablebases
+    if (whites > 0)
+    {
+        generate(whites - 1, blacks);
+    }
+    if (blacks > 0)
+    {
+        generate(whites, blacks - 1);
+    }
+
+    auto maxChildPlies = 0u;
+    for (auto& [pieces, smaller] : m_tables)
+    {
+        maxChildPlies = std::max(maxChildPlies, smaller.maxPlies);
+    }
+
+    auto& table =
+        m_tables.emplace(std::pair {whites, blacks}, Table {{m_dimension, whites, blacks}, {}})
+            .first->second;
+    auto& layout = table.layout;
+    table.entries.resize(layout.size());
+
+    // Mark the impossible positions, and the ones which white has already won
+    for (auto i = 0ull; i < layout.size(); i++)
+    {
+        auto position = layout.position(i);
+
+        if (!layout.isValid(position))
+        {
+            table.entries[i] = TablebaseEntry::kInvalid;
+        }
+        else if (isOnEdge(position.king, m_dimension))
+        {
+            table.entries[i] = position.turn == Color::Black ? TablebaseEntry::encode(0)
+                                                             : TablebaseEntry::kInvalid;
+        }
+    }
+
+    for (auto pass = 1u; pass <= TablebaseEntry::kMaxPlies; pass++)
+    {
+        std::atomic<uint64_t> nextBlock {0};
+        std::atomic<bool> changed {false};
+        std::vector<std::thread> threads;
+
+        for (auto thr = 0u; thr < m_threads; thr++)
+        {
+            threads.emplace_back([this, &table, &nextBlock, &changed, pass]() {
+                const auto size = table.layout.size();
+
+                for (auto first = nextBlock.fetch_add(kBlockSize); first < size;
+                     first = nextBlock.fetch_add(kBlockSize))
+                {
+                    if (solve(table, pass, first, std::min(first + kBlockSize, size)))
+                    {
+                        changed = true;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        if (changed)
+        {
+            table.maxPlies = pass;
+        }
+        else if (pass > maxChildPlies + 1)
+        {
+            // Nothing can be decided by later passes
+            break;
+        }
+    }
+
+    return table.entries;
+}
+
+bool
+TablebaseGenerator::solve(Table& table, unsigned pass, uint64_t first, uint64_t last) const
+{
+    auto changed = false;
+
+    for (auto i = first; i < last; i++)
+    {
+        std::atomic_ref<uint8_t> current(table.entries[i]);
+        if (current.load(std::memory_order_relaxed) != TablebaseEntry::kUnknown)
+        {
+            continue;
+        }
+
+        auto position = table.layout.position(i);
+        auto moves = 0u;
+        auto wins = false;
+        auto undecided = false;
+
+        // Only children solved in earlier passes count, so the plies are exact
+        forEachChild(position,
+                     m_dimension,
+                     [this, &table, pass, &moves, &wins, &undecided](
+                         const TablebasePosition& child, std::optional<Color> winner) {
+                         moves++;
+                         if (winner)
+                         {
+                             // Only the player making a move can win with it
+                             wins = true;
+                             return;
+                         }
+
+                         auto childEntry = entry(table, child);
+                         if (childEntry == TablebaseEntry::kUnknown || childEntry > pass)
+                         {
+                             undecided = true;
+                         }
+                         else if ((childEntry - 1) % 2 == 0)
+                         {
+                             // Lost for the opponent
+                             wins = true;
+                         }
+                     });
+
+        if (wins || (moves > 0 && !undecided))
+        {
+            current.store(TablebaseEntry::encode(pass), std::memory_order_relaxed);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+uint8_t
+TablebaseGenerator::entry(Table& table, const TablebasePosition& position) const
+{
+    auto whites = static_cast<unsigned>(std::popcount(position.whites));
+    auto blacks = static_cast<unsigned>(std::popcount(position.blacks));
+
+    if (whites == table.layout.getWhites() && blacks == table.layout.getBlacks())
+    {
+        return std::atomic_ref<uint8_t>(table.entries[table.layout.index(position)])
+            .load(std::memory_order_relaxed);
+    }
+
+    // After a capture
+    auto& smaller = m_tables.at({whites, blacks});
+
+    return smaller.entries[smaller.layout.index(position)];
+}
+
+uint64_t
+Tablebases::generatedSize(unsigned dimension, unsigned whites, unsigned blacks)
+{
+    uint64_t out = 0;
+
+    for (auto w = 0u; w <= whites; w++)
+    {
+        for (auto b = 0u; b <= blacks; b++)
+        {
+            out += TablebaseLayout(dimension, w, b).size();
+        }
+    }
+
+    return out;
+}
+
+bool
+Tablebases::generate(unsigned dimension,
+                     unsigned whites,
+                     unsigned blacks,
+                     const std::string& directory,
+                     unsigned threads)
+{
+    if (dimension < 3 || dimension > kMaxDimension || whites > kMaxPieces ||
+        blacks > kMaxPieces || generatedSize(dimension, whites, blacks) > kMaxGeneratedSize)
+    {
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    TablebaseGenerator generator(dimension, threads);
+    for (auto w = 0u; w <= whites; w++)
+    {
+        for (auto b = 0u; b <= blacks; b++)
+        {
+            TablebaseLayout layout(dimension, w, b);
+
+            if (!TablebaseFile::write(
+                    tablebasePath(directory, layout).string(), layout, generator.generate(w, b)))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+unsigned
+Tablebases::load(const std::string& directory)
+{
+    auto count = 0u;
+    std::error_code error;
+
+    for (auto& file : std::filesystem::directory_iterator(directory, error))
+    {
+        if (file.path().extension() != ".tb")
+        {
+            continue;
+        }
+
+        if (auto tablebase = TablebaseFile::open(file.path().string()))
+        {
+            TablebaseFile::loaded().push_back(std::move(tablebase));
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void
+Tablebases::unload()
+{
+    TablebaseFile::loaded().clear();
+}
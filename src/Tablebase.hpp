@@ -0,0 +1,152 @@
+#pragma once
+
+#include <Color.hpp>
+#include <Tablebase.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tafl
+{
+
+// A position in a tablebase, with the squares of the pieces besides the king as bitmasks
+struct TablebasePosition
+{
+    unsigned king {0};
+    uint64_t whites {0};
+    uint64_t blacks {0};
+    Color turn {Color::White};
+};
+
+/*
+ * The positions for a board dimension and a number of pieces besides the king.
+ *
+ * A position is indexed by the king square, the ranks of the sets of white and black
+ * squares and the side to move. Indices of impossible positions, with overlapping
+ * pieces, are left unused.
+ */
+class TablebaseLayout
+{
+public:
+    TablebaseLayout(unsigned dimension, unsigned whites, unsigned blacks);
+
+    unsigned getDimension() const;
+
+    unsigned getWhites() const;
+
+    unsigned getBlacks() const;
+
+    uint64_t size() const;
+
+    uint64_t index(const TablebasePosition& position) const;
+
+    TablebasePosition position(uint64_t index) const;
+
+    // No overlapping pieces, and nothing but the king in the castle
+    bool isValid(const TablebasePosition& position) const;
+
+private:
+    const unsigned m_dimension;
+    const unsigned m_whites;
+    const unsigned m_blacks;
+    const uint64_t m_squares;
+    const uint64_t m_whiteSets;
+    const uint64_t m_blackSets;
+};
+
+/*
+ * A tablebase entry holds the number of plies until the game is won, plus one. The
+ * side to move wins if the plies are odd, i.e., 1 is a position which is already lost
+ * and 2 is won with the next move.
+ */
+struct TablebaseEntry
+{
+    // Drawn or not solved
+    static constexpr uint8_t kUnknown = 0;
+    static constexpr uint8_t kInvalid = 255;
+    static constexpr unsigned kMaxPlies = 253;
+
+    static constexpr uint8_t encode(unsigned plies)
+    {
+        return static_cast<uint8_t>(plies + 1);
+    }
+
+    static std::optional<TablebaseResult> decode(uint8_t entry, Color turn);
+};
+
+// A memory-mapped tablebase file
+class TablebaseFile
+{
+public:
+    ~TablebaseFile();
+
+    TablebaseFile(const TablebaseFile&) = delete;
+
+    TablebaseFile& operator=(const TablebaseFile&) = delete;
+
+    // Map a file, nullptr if it's not a valid tablebase
+    static std::unique_ptr<TablebaseFile> open(const std::string& path);
+
+    static bool write(const std::string& path,
+                      const TablebaseLayout& layout,
+                      const std::vector<uint8_t>& entries);
+
+    // The loaded tablebase for a board and pieces, or nullptr
+    static const TablebaseFile* find(unsigned dimension, unsigned whites, unsigned blacks);
+
+    static std::vector<std::unique_ptr<TablebaseFile>>& loaded();
+
+    const TablebaseLayout& getLayout() const;
+
+    std::optional<TablebaseResult> probe(const TablebasePosition& position) const;
+
+private:
+    TablebaseFile(const TablebaseLayout& layout, void* mapping, size_t size);
+
+    const TablebaseLayout m_layout;
+    void* m_mapping;
+    const size_t m_size;
+    const uint8_t* m_entries;
+};
+
+/*
+ * Generates tablebases by iterating over all positions once per ply: a position is
+ * solved in the pass which equals its plies to the end of the game, once the children
+ * which decide it have been solved in earlier passes. The positions are split between
+ * the threads in each pass.
+ *
+ * The tablebases with fewer pieces, which captures lead to, are generated first.
+ */
+class TablebaseGenerator
+{
+public:
+    TablebaseGenerator(unsigned dimension, unsigned threads);
+
+    // Generate the tablebase for a number of pieces, and the smaller ones first
+    const std::vector<uint8_t>& generate(unsigned whites, unsigned blacks);
+
+private:
+    struct Table
+    {
+        TablebaseLayout layout;
+        std::vector<uint8_t> entries;
+        // The most plies of any solved position
+        unsigned maxPlies {0};
+    };
+
+    // Solve the positions in [first, last) which are decided in a pass
+    bool solve(Table& table, unsigned pass, uint64_t first, uint64_t last) const;
+
+    // The entry of a position, in the table which is generated or a smaller one
+    uint8_t entry(Table& table, const TablebasePosition& position) const;
+
+    const unsigned m_dimension;
+    const unsigned m_threads;
+    std::map<std::pair<unsigned, unsigned>, Table> m_tables;
+};
+
+} // namespace tafl
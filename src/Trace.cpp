@@ -0,0 +1,229 @@
+#include "Trace.hpp"
+
+#include <Tracing.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <fmt/format.h>
+#include <fstream>
+#include <mutex>
+
+using namespace tafl;
+using namespace tafl::trace;
+
+namespace
+{
+
+std::mutex g_traceMutex;
+
+std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+// Never reused, since reset() drops the traces of the threads which have exited
+std::atomic<unsigned> g_nextThreadId {0};
+
+} // namespace
+
+const char*
+trace::name(Phase phase)
+{
+    constexpr std::array<const char*, static_cast<size_t>(Phase::Count)> kNames {
+        "search",
+        "playout",
+        "move generation",
+        "random move",
+        "move",
+        "scan captures",
+        "get winner",
+        "board copy",
+        "hash probe",
+        "aggregation",
+    };
+
+    return kNames[static_cast<size_t>(phase)];
+}
+
+const char*
+trace::name(Counter counter)
+{
+    constexpr std::array<const char*, static_cast<size_t>(Counter::Count)> kNames {
+        "captures",
+        "transposition hits",
+        "transposition misses",
+    };
+
+    return kNames[static_cast<size_t>(counter)];
+}
+
+void
+Histogram::add(std::chrono::nanoseconds duration)
+{
+    auto ns = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+
+    count++;
+    total += duration;
+    buckets[std::min<size_t>(std::bit_width(ns), buckets.size() - 1)]++;
+}
+
+std::chrono::nanoseconds
+Histogram::quantile(double q) const
+{
+    auto remaining = static_cast<uint64_t>(q * count);
+
+    for (auto i = 0u; i < buckets.size(); i++)
+    {
+        if (buckets[i] > remaining)
+        {
+            // Bucket i holds durations below 2^i
+            return std::chrono::nanoseconds(uint64_t(1) << i);
+        }
+        remaining -= buckets[i];
+    }
+
+    return std::chrono::nanoseconds::max();
+}
+
+ThreadTrace&
+trace::threadTrace()
+{
+    thread_local std::shared_ptr<ThreadTrace> trace = []() {
+        std::lock_guard lock(g_traceMutex);
+        auto& traces = allThreadTraces();
+
+        auto out = std::make_shared<ThreadTrace>();
+        out->id = g_nextThreadId.fetch_add(1, std::memory_order_relaxed);
+        traces.push_back(out);
+
+        return out;
+    }();
+
+    return *trace;
+}
+
+std::vector<std::shared_ptr<ThreadTrace>>&
+trace::allThreadTraces()
+{
+    static std::vector<std::shared_ptr<ThreadTrace>> traces;
+
+    return traces;
+}
+
+void
+trace::record(Phase phase, std::chrono::steady_clock::time_point start)
+{
+    auto duration = std::chrono::steady_clock::now() - start;
+    auto& trace = threadTrace();
+
+    trace.histograms[static_cast<size_t>(phase)].add(duration);
+    if (trace.events.size() < ThreadTrace::kMaxEvents)
+    {
+        trace.events.push_back({phase, start - g_epoch, duration});
+    }
+}
+
+bool
+Tracing::isEnabled()
+{
+#ifdef TAFL_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool
+Tracing::writeChromeTrace(const std::string& path)
+{
+    if (!isEnabled())
+    {
+        return false;
+    }
+
+    std::lock_guard lock(g_traceMutex);
+    std::ofstream out(path, std::ios::trunc);
+    auto separator = "";
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    for (auto& trace : allThreadTraces())
+    {
+        for (auto& event : trace->events)
+        {
+            // The timestamps are in microseconds
+            out << fmt::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                               "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                               separator,
+                               name(event.phase),
+                               trace->id,
+                               event.start.count() / 1000.0,
+                               event.duration.count() / 1000.0);
+            separator = ",\n";
+        }
+    }
+    out << "\n]}\n";
+
+    return out.good();
+}
+
+std::string
+Tracing::formatHistograms()
+{
+    std::lock_guard lock(g_traceMutex);
+    std::string out;
+
+    for (auto& trace : allThreadTraces())
+    {
+        out += fmt::format("thread {}\n", trace->id);
+        out += fmt::format("  {:<20} {:>12} {:>12} {:>10} {:>10} {:>10}\n",
+                           "phase",
+                           "count",
+                           "total ms",
+                           "mean ns",
+                           "p50 ns <",
+                           "p99 ns <");
+
+        for (auto i = 0u; i < trace->histograms.size(); i++)
+        {
+            auto& histogram = trace->histograms[i];
+            if (histogram.count == 0)
+            {
+                continue;
+            }
+
+            out += fmt::format("  {:<20} {:>12} {:>12.3f} {:>10} {:>10} {:>10}\n",
+                               name(static_cast<Phase>(i)),
+                               histogram.count,
+                               histogram.total.count() / 1e6,
+                               histogram.total.count() / histogram.count,
+                               histogram.quantile(0.5).count(),
+                               histogram.quantile(0.99).count());
+        }
+        for (auto i = 0u; i < trace->counters.size(); i++)
+        {
+            if (trace->counters[i])
+            {
+                out += fmt::format(
+                    "  {:<20} {:>12}\n", name(static_cast<Counter>(i)), trace->counters[i]);
+            }
+        }
+    }
+
+    return out;
+}
+
+void
+Tracing::reset()
+{
+    std::lock_guard lock(g_traceMutex);
+    auto& traces = allThreadTraces();
+
+    // The traces of the threads which have exited are only referenced here
+    std::erase_if(traces, [](const std::shared_ptr<ThreadTrace>& trace) {
+        return trace.use_count() == 1;
+    });
+    for (auto& trace : traces)
+    {
+        trace->histograms = {};
+        trace->counters = {};
+        trace->events = {};
+    }
+    g_epoch = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * Scoped timers and counters for the phases of the engine, which compile to nothing
+ * unless TAFL_TRACE is defined:
+ *
+ *   TAFL_TRACE_SCOPE(Move);          // times the rest of the enclosing scope
+ *   TAFL_TRACE_COUNT(Captures, n);   // adds n to a counter
+ */
+#ifdef TAFL_TRACE
+#define TAFL_TRACE_CONCAT_(a, b) a##b
+#define TAFL_TRACE_CONCAT(a, b) TAFL_TRACE_CONCAT_(a, b)
+#define TAFL_TRACE_SCOPE(phase)                                                                    \
+    ::tafl::trace::Scope TAFL_TRACE_CONCAT(traceScope, __LINE__)(::tafl::trace::Phase::phase)
+#define TAFL_TRACE_COUNT(counter, n) ::tafl::trace::count(::tafl::trace::Counter::counter, n)
+#else
+#define TAFL_TRACE_SCOPE(phase) static_cast<void>(0)
+#define TAFL_TRACE_COUNT(counter, n) static_cast<void>(0)
+#endif
+
+namespace tafl::trace
+{
+
+enum class Phase : uint8_t
+{
+    Search,
+    Playout,
+    MoveGeneration,
+    RandomMove,
+    Move,
+    ScanCaptures,
+    GetWinner,
+    BoardCopy,
+    HashProbe,
+    Aggregation,
+    Count,
+};
+
+enum class Counter : uint8_t
+{
+    Captures,
+    TranspositionHits,
+    TranspositionMisses,
+    Count,
+};
+
+const char* name(Phase phase);
+
+const char* name(Counter counter);
+
+// A complete event of the Chrome trace format
+struct Event
+{
+    Phase phase;
+    // Since the epoch of the recording
+    std::chrono::nanoseconds start;
+    std::chrono::nanoseconds duration;
+};
+
+// The durations of a phase, in buckets of powers of 2 nanoseconds
+struct Histogram
+{
+    uint64_t count {0};
+    std::chrono::nanoseconds total {0};
+    std::array<uint64_t, 64> buckets {};
+
+    void add(std::chrono::nanoseconds duration);
+
+    // The upper bound of the bucket with the share @a q of the durations
+    std::chrono::nanoseconds quantile(double q) const;
+};
+
+// What one thread recorded, kept after the thread exits
+struct ThreadTrace
+{
+    // Events beyond this are only added to the histograms
+    static constexpr size_t kMaxEvents = 1 << 18;
+
+    unsigned id;
+    std::array<Histogram, static_cast<size_t>(Phase::Count)> histograms;
+    std::array<uint64_t, static_cast<size_t>(Counter::Count)> counters {};
+    std::vector<Event> events;
+};
+
+// The trace of the calling thread
+ThreadTrace& threadTrace();
+
+// The traces of all threads which have recorded anything
+std::vector<std::shared_ptr<ThreadTrace>>& allThreadTraces();
+
+void record(Phase phase, std::chrono::steady_clock::time_point start);
+
+inline void
+count(Counter counter, uint64_t n)
+{
+    threadTrace().counters[static_cast<size_t>(counter)] += n;
+}
+
+class Scope
+{
+public:
+    explicit Scope(Phase phase)
+        : m_phase(phase)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~Scope()
+    {
+        record(m_phase, m_start);
+    }
+
+    Scope(const Scope&) = delete;
+
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const Phase m_phase;
+    const std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace tafl::trace
@@ -1,36 +1,114 @@
+#include <Evaluation.hpp>
+#include <NeuralNetwork.hpp>
+#include <GameRecords.hpp>
 #include <IBoard.hpp>
+#include <Tracing.hpp>
 #include <fmt/format.h>
+#include <string>
+#include <vector>
 
 using namespace tafl;
 using namespace std::chrono_literals;
 
+/*
+ * Play a game of Tablut against itself.
+ *
+ *   auto-player [--weights file] [--network file] [--patterns] [--record file]
+ *
+ * With a weights file, as written by the tuner, the playouts are scored by its
+ * evaluation, and with a network file by the network. With --patterns, the moves of the
+ * playouts are chosen by SearchConfig::patternPlayouts. With a record file, the game is
+ * appended to it once it's over.
+ */
 int
 main(int argc, const char* argv[])
 {
+    SearchConfig config;
+    config.quota = 2s;
+    std::string recordPath;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto hasValue = i + 1 < argc;
+
+        if (arg == "--weights" && hasValue)
+        {
+            auto evaluation = Evaluation::load(argv[++i]);
+            if (!evaluation)
+            {
+                fmt::print(stderr, "Failed to load the weights from {}\n", argv[i]);
+                return 1;
+            }
+            config.evaluation = std::make_shared<Evaluation>(*evaluation);
+        }
+        else if (arg == "--network" && hasValue)
+        {
+            config.network = NeuralNetwork::load(argv[++i]);
+            if (!config.network)
+            {
+                fmt::print(stderr, "Failed to load the network from {}\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (arg == "--patterns")
+        {
+            config.patternPlayouts = true;
+        }
+        else if (arg == "--record" && hasValue)
+        {
+            recordPath = argv[++i];
+        }
+        else
+        {
+            fmt::print(stderr,
+                       "Usage: {} [--weights file] [--network file] [--patterns] [--record file]\n",
+                       argv[0]);
+            return 1;
+        }
+    }
+
     auto board = IBoard::fromString(kTablut);
-    const auto dim = board->getBoardDimension();
+    auto start = board->clone();
+    std::vector<Move> played;
 
     fmt::print("\033[H\033[2J");
     fmt::print("\n");
     auto winner = board->getWinner();
+    auto moves = 0u;
     do
     {
         IBoard::printBoard(*board);
-        auto best = board->calculateBestMove(2s, []() {});
-        best.wait();
+        Tracing::reset();
+        auto result = board->search(config).get();
+
+        if (Tracing::isEnabled())
+        {
+            // Where the time of this move went
+            auto path = fmt::format("tafl-trace-{}.json", moves++);
+
+            fmt::print("{}", Tracing::formatHistograms());
+            if (Tracing::writeChromeTrace(path))
+            {
+                fmt::print("Trace written to {}\n", path);
+            }
+        }
 
-        if (best.valid())
+        if (result.bestMove)
         {
-            auto m = best.get().value();
+            auto m = *result.bestMove;
             auto f = m.from;
             auto t = m.to;
 
-            // Clear the screen
-//            fmt::print("\033[H\033[2J");
+            fmt::print("{} playouts in {} ms, {} reused\n",
+                       result.playouts,
+                       result.elapsed.count(),
+                       result.reusedVisits);
             fmt::print("Best move for {}: {}:{} -> {}:{}\n", board->getTurn() == Color::Black ? "Black" : "White",
              f.x, f.y, t.x, t.y);
 
             board->move(m);
+            played.push_back(m);
         }
         else
         {
@@ -45,5 +123,15 @@ main(int argc, const char* argv[])
         IBoard::printBoard(*board);
     }
 
+    if (!recordPath.empty())
+    {
+        auto writer = GameRecordWriter::open(recordPath, "tablut", *start);
+        if (!writer || !writer->add(played, winner) || !writer->flush())
+        {
+            fmt::print(stderr, "Failed to record the game in {}\n", recordPath);
+            return 1;
+        }
+    }
+
     return 0;
 }
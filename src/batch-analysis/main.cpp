@@ -0,0 +1,115 @@
+#include <BatchAnalysis.hpp>
+#include <Evaluation.hpp>
+#include <NeuralNetwork.hpp>
+#include <chrono>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace tafl;
+
+/*
+ * Analyse an archive of positions, either packed or one "<board>[;<w|b>]" per line as
+ * described in PositionFormat.hpp, and write a JSON object per position to stdout as
+ * soon as it's analysed.
+ *
+ *   batch-analysis [--playouts n] [--threads n] [--memory-mb n] [--seed n] [--moves n]
+ *                  [--weights file] [--network file] [file]
+ *
+ * The positions are read from stdin without a file. The throughput is written to stderr.
+ * With a weights file, as written by the tuner, the playouts are scored by its
+ * evaluation, and with a network file by the network.
+ */
+int
+main(int argc, const char* argv[])
+{
+    BatchConfig config;
+    auto moves = 5u;
+    std::string path;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto hasValue = i + 1 < argc;
+
+        if (arg == "--playouts" && hasValue)
+        {
+            config.playouts = std::stoull(argv[++i]);
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            config.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--memory-mb" && hasValue)
+        {
+            config.memoryLimit = std::stoull(argv[++i]) * 1024 * 1024;
+        }
+        else if (arg == "--seed" && hasValue)
+        {
+            config.seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--moves" && hasValue)
+        {
+            moves = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--weights" && hasValue)
+        {
+            auto evaluation = Evaluation::load(argv[++i]);
+            if (!evaluation)
+            {
+                fmt::print(stderr, "Failed to load the weights from {}\n", argv[i]);
+                return 1;
+            }
+            config.evaluation = std::make_shared<Evaluation>(*evaluation);
+        }
+        else if (arg == "--network" && hasValue)
+        {
+            config.network = NeuralNetwork::load(argv[++i]);
+            if (!config.network)
+            {
+                fmt::print(stderr, "Failed to load the network from {}\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (!arg.starts_with("--") && path.empty())
+        {
+            path = arg;
+        }
+        else
+        {
+            fmt::print(stderr,
+                       "Usage: {} [--playouts n] [--threads n] [--memory-mb n] [--seed n] "
+                       "[--moves n] [--weights file] [--network file] [file]\n",
+                       argv[0]);
+            return 1;
+        }
+    }
+
+    std::ifstream file;
+    if (!path.empty())
+    {
+        file.open(path, std::ios::binary);
+        if (!file)
+        {
+            fmt::print(stderr, "Failed to open {}\n", path);
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto positions =
+        BatchAnalysis::run(path.empty() ? std::cin : file, config, [moves](const BatchResult& r) {
+            fmt::print("{}\n", BatchAnalysis::toJson(r, moves));
+            std::fflush(stdout);
+        });
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    fmt::print(stderr,
+               "{} positions in {:.1f} s, {:.0f} positions/hour\n",
+               positions,
+               elapsed.count(),
+               positions * 3600 / std::max(elapsed.count(), 1e-9));
+
+    return 0;
+}
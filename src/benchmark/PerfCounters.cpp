@@ -0,0 +1,157 @@
+#include "PerfCounters.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fmt/format.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace tafl;
+
+namespace
+{
+
+#ifdef __linux__
+struct EventConfig
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr std::array<EventConfig, PerfCounters::Event::Count> kConfigs {
+    EventConfig {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    EventConfig {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    EventConfig {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    EventConfig {PERF_TYPE_HW_CACHE,
+                 PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    EventConfig {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+int
+openEvent(const EventConfig& config)
+{
+    perf_event_attr attr {};
+    attr.size = sizeof(attr);
+    attr.type = config.type;
+    attr.config = config.config;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+    m_fds.fill(-1);
+
+#ifdef __linux__
+    for (auto i = 0u; i < m_fds.size(); i++)
+    {
+        m_fds[i] = openEvent(kConfigs[i]);
+        if (m_fds[i] < 0 && m_error.empty())
+        {
+            m_error = fmt::format("perf_event_open failed: {}", std::strerror(errno));
+        }
+    }
+#else
+    m_error = "perf_event_open is only available on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (auto fd : m_fds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+const char*
+PerfCounters::name(Event event)
+{
+    constexpr std::array<const char*, Event::Count> kNames {
+        "cycles",
+        "instructions",
+        "branch-misses",
+        "L1-misses",
+        "LLC-misses",
+    };
+
+    return kNames[event];
+}
+
+bool
+PerfCounters::isAvailable() const
+{
+    return std::ranges::any_of(m_fds, [](auto fd) { return fd >= 0; });
+}
+
+const std::string&
+PerfCounters::getError() const
+{
+    return m_error;
+}
+
+PerfCounters::RawReadings
+PerfCounters::read() const
+{
+    RawReadings out {};
+
+#ifdef __linux__
+    for (auto i = 0u; i < m_fds.size(); i++)
+    {
+        if (m_fds[i] >= 0 && ::read(m_fds[i], out[i].data(), sizeof(out[i])) != sizeof(out[i]))
+        {
+            out[i] = {};
+        }
+    }
+#endif
+
+    return out;
+}
+
+void
+PerfCounters::start()
+{
+    m_start = read();
+}
+
+PerfCounters::Readings
+PerfCounters::stop()
+{
+    auto end = read();
+    Readings out;
+
+    for (auto i = 0u; i < m_fds.size(); i++)
+    {
+        auto value = end[i][0] - m_start[i][0];
+        auto enabled = end[i][1] - m_start[i][1];
+        auto running = end[i][2] - m_start[i][2];
+
+        if (m_fds[i] < 0 || running == 0)
+        {
+            continue;
+        }
+        // The counter only ran for part of the time if there were more events than
+        // hardware counters
+        out[i] = static_cast<uint64_t>(static_cast<double>(value) * enabled / running);
+    }
+
+    return out;
+}
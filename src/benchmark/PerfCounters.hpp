@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace tafl
+{
+
+/*
+ * Hardware performance counters of the calling process, read with perf_event_open on
+ * Linux. The threads started after the counters are created are counted too, so that
+ * searches are measured on all their threads. The counters run all the time and a
+ * measurement is the difference of two readings, since resetting them would not reset
+ * what the exited threads counted.
+ *
+ * Counters which can't be opened, as in most containers or without the permission
+ * given by kernel.perf_event_paranoid, are reported as missing rather than failing.
+ */
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        Cycles,
+        Instructions,
+        BranchMisses,
+        L1Misses,
+        LlcMisses,
+        Count,
+    };
+
+    using Readings = std::array<std::optional<uint64_t>, Event::Count>;
+
+    PerfCounters();
+
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    static const char* name(Event event);
+
+    // Can any counter be read?
+    bool isAvailable() const;
+
+    // Why no counter can be read, if none can
+    const std::string& getError() const;
+
+    // Start a measurement
+    void start();
+
+    // The counts since start(), scaled up if the kernel multiplexed the counters
+    Readings stop();
+
+private:
+    // The value, the time enabled and the time running of each counter
+    using RawReadings = std::array<std::array<uint64_t, 3>, Event::Count>;
+
+    RawReadings read() const;
+
+    std::array<int, Event::Count> m_fds;
+    std::string m_error;
+    RawReadings m_start {};
+};
+
+} // namespace tafl
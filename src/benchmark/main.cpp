@@ -0,0 +1,243 @@
+#include "PerfCounters.hpp"
+
+#include <IBoard.hpp>
+#include <Tracing.hpp>
+#include <array>
+#include <fmt/format.h>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tafl;
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// Random games longer than this are cut short
+constexpr auto kMaxPlies = 200u;
+constexpr auto kCopies = 100000u;
+constexpr auto kGames = 1000u;
+
+struct Position
+{
+    const char* name;
+    std::string board;
+    Color turn;
+    // Is the move correct? Always true for positions which only measure throughput
+    std::function<bool(IBoard& board, const Move& move)> isCorrect;
+};
+
+const auto kPositions = std::array {
+    Position {"tablut-opening", kTablut, Color::White, [](IBoard&, const Move&) { return true; }},
+    Position {"white-wins-in-one",
+              " w b "
+              " wb  "
+              " k  b"
+              "bb   "
+              "   b ",
+              Color::White,
+              [](IBoard& board, const Move& move) {
+                  board.move(move);
+                  return board.getWinner() == Color::White;
+              }},
+    Position {"black-must-block",
+              "    b w  "
+              "   wb    "
+              "      w  "
+              "b    w b "
+              "b  w  kbb"
+              "  b  w b "
+              "b w b    "
+              " b       "
+              " b b b  w",
+              Color::Black,
+              [](IBoard& board, const Move& move) {
+                  std::array<Move, 4> escapes;
+
+                  board.move(move);
+                  return board.getKingEscapes(escapes).empty();
+              }},
+};
+
+// The hardware counters of an operation repeated a number of times
+struct CounterRow
+{
+    std::string name;
+    uint64_t count;
+    PerfCounters::Readings readings;
+};
+
+std::unique_ptr<IBoard>
+createBoard(const Position& position)
+{
+    auto board = IBoard::fromString(position.board);
+    board->setTurn(position.turn);
+
+    return board;
+}
+
+// Play random games from the position and return the number of moves made
+uint64_t
+playRandomGames(const IBoard& board, unsigned games)
+{
+    std::mt19937 random(0);
+    uint64_t out = 0;
+
+    for (auto game = 0u; game < games; game++)
+    {
+        auto copy = board.clone();
+
+        for (auto ply = 0u; ply < kMaxPlies && !copy->getWinner(); ply++)
+        {
+            auto move = copy->getRandomMove(random());
+            if (!move)
+            {
+                break;
+            }
+            copy->move(*move);
+            out++;
+        }
+    }
+
+    return out;
+}
+
+void
+printCounters(const char* unit, const std::vector<CounterRow>& rows)
+{
+    fmt::print("\n{:<24} {:>10}", fmt::format("per {}", unit), "IPC");
+    for (auto event = 0; event < PerfCounters::Count; event++)
+    {
+        fmt::print(" {:>13}", PerfCounters::name(static_cast<PerfCounters::Event>(event)));
+    }
+    fmt::print("\n");
+
+    for (auto& row : rows)
+    {
+        auto& cycles = row.readings[PerfCounters::Cycles];
+        auto& instructions = row.readings[PerfCounters::Instructions];
+
+        fmt::print("{:<24} {:>10}",
+                   row.name,
+                   cycles && instructions && *cycles
+                       ? fmt::format("{:.2f}", static_cast<double>(*instructions) / *cycles)
+                       : "n/a");
+        for (auto& reading : row.readings)
+        {
+            auto perUnit = reading && row.count ? static_cast<double>(*reading) / row.count : -1;
+
+            fmt::print(" {:>13}", perUnit >= 0 ? fmt::format("{:.1f}", perUnit) : "n/a");
+        }
+        fmt::print("\n");
+    }
+}
+
+} // namespace
+
+/*
+ * Measure the search throughput and check the moves found.
+ *
+ *   benchmark [quota-ms] [max-threads] [playouts]
+ *
+ * With a number of playouts, each run is a seeded search which stops after them instead
+ * of after the quota, so that the moves are the same from one benchmark to the next.
+ *
+ * Where the hardware performance counters can be read, the cycles, instructions, branch
+ * misses and cache misses are also reported per playout, and per board copy and move
+ * of random games.
+ */
+int
+main(int argc, const char* argv[])
+{
+    auto quota = argc > 1 ? std::chrono::milliseconds(std::stoul(argv[1])) : 1000ms;
+    auto maxThreads = argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+    auto budget = argc > 3 ? std::stoull(argv[3]) : 0;
+    const auto runs = 3u;
+    PerfCounters counters;
+    std::vector<CounterRow> searchRows;
+
+    fmt::print("{:<20} {:>8} {:>14} {:>8}\n", "position", "threads", "playouts/s", "correct");
+    for (auto& position : kPositions)
+    {
+        for (auto threads = 1u; threads <= maxThreads; threads *= 2)
+        {
+            uint64_t playouts = 0;
+            uint64_t ms = 0;
+            auto correct = 0u;
+
+            counters.start();
+            for (auto run = 0u; run < runs; run++)
+            {
+                auto board = createBoard(position);
+
+                SearchConfig config;
+                config.quota = quota;
+                config.threads = threads;
+                if (budget)
+                {
+                    config.playouts = budget;
+                    config.seed = run;
+                }
+
+                auto result = board->search(config).get();
+                playouts += result.playouts;
+                ms += result.elapsed.count();
+                if (result.bestMove && position.isCorrect(*board, *result.bestMove))
+                {
+                    correct++;
+                }
+            }
+            searchRows.push_back(
+                {fmt::format("{}/{}", position.name, threads), playouts, counters.stop()});
+
+            fmt::print("{:<20} {:>8} {:>14.0f} {:>5}/{}\n",
+                       position.name,
+                       threads,
+                       playouts * 1000.0 / std::max<uint64_t>(ms, 1),
+                       correct,
+                       runs);
+        }
+    }
+
+    if (counters.isAvailable())
+    {
+        std::vector<CounterRow> ruleRows;
+
+        for (auto& position : kPositions)
+        {
+            auto board = createBoard(position);
+
+            counters.start();
+            for (auto copy = 0u; copy < kCopies; copy++)
+            {
+                board->clone();
+            }
+            ruleRows.push_back({fmt::format("{}/copy", position.name), kCopies, counters.stop()});
+
+            counters.start();
+            auto moves = playRandomGames(*board, kGames);
+            ruleRows.push_back({fmt::format("{}/move", position.name), moves, counters.stop()});
+        }
+
+        printCounters("playout", searchRows);
+        printCounters("operation", ruleRows);
+    }
+    else
+    {
+        fmt::print("\nHardware counters unavailable: {}\n", counters.getError());
+    }
+
+    if (Tracing::isEnabled())
+    {
+        fmt::print("\n{}", Tracing::formatHistograms());
+        if (Tracing::writeChromeTrace("benchmark-trace.json"))
+        {
+            fmt::print("Trace written to benchmark-trace.json\n");
+        }
+    }
+
+    return 0;
+}
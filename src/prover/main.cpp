@@ -0,0 +1,99 @@
+#include <IBoard.hpp>
+#include <fmt/format.h>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace tafl;
+
+namespace
+{
+
+std::optional<Color>
+parseColor(const std::string& s)
+{
+    if (s == "w" || s == "white")
+    {
+        return Color::White;
+    }
+    if (s == "b" || s == "black")
+    {
+        return Color::Black;
+    }
+
+    return std::nullopt;
+}
+
+} // namespace
+
+/*
+ * Prove or disprove that a player wins within a number of moves.
+ *
+ *   prover <turn: w|b> <attacker: w|b> [moves] [node-limit] < board.txt
+ *
+ * The colors are w or white and b or black. The board is read from stdin, one row per
+ * line.
+ */
+int
+main(int argc, const char* argv[])
+{
+    auto turn = argc < 3 ? std::nullopt : parseColor(argv[1]);
+    auto attacker = argc < 3 ? std::nullopt : parseColor(argv[2]);
+    if (!turn || !attacker)
+    {
+        fmt::print(stderr, "Usage: {} <turn: w|b> <attacker: w|b> [moves] [node-limit]\n", argv[0]);
+        return 1;
+    }
+
+    std::string boardString;
+    for (std::string line; std::getline(std::cin, line);)
+    {
+        boardString += line;
+    }
+
+    auto board = IBoard::fromString(boardString);
+    if (!board)
+    {
+        fmt::print(stderr, "Invalid board\n");
+        return 1;
+    }
+    board->setTurn(*turn);
+
+    ProofConfig config;
+    config.attacker = *attacker;
+    if (argc > 3)
+    {
+        config.moves = std::stoul(argv[3]);
+    }
+    if (argc > 4)
+    {
+        config.nodeLimit = std::stoull(argv[4]);
+    }
+
+    IBoard::printBoard(*board);
+
+    auto result = board->prove(config);
+    auto name = config.attacker == Color::White ? "White" : "Black";
+    switch (result.proof)
+    {
+    case Proof::Proven:
+        fmt::print("{} wins within {} moves", name, config.moves);
+        break;
+    case Proof::Disproven:
+        fmt::print("{} can't win within {} moves", name, config.moves);
+        break;
+    case Proof::Unknown:
+        fmt::print("Unknown after the node limit");
+        break;
+    }
+    if (result.move)
+    {
+        auto f = result.move->from;
+        auto t = result.move->to;
+
+        fmt::print(", {}:{} -> {}:{}", f.x, f.y, t.x, t.y);
+    }
+    fmt::print(" ({} nodes)\n", result.nodes);
+
+    return result.proof == Proof::Unknown ? 2 : 0;
+}
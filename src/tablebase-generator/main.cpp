@@ -0,0 +1,71 @@
+#include <Tablebase.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fmt/format.h>
+#include <string>
+#include <thread>
+
+using namespace tafl;
+
+/*
+ * Generate the tablebases for a board dimension, with the king and up to a number of
+ * white and black pieces.
+ *
+ *   tablebase-generator <dimension> <whites> <blacks> <directory> [threads]
+ */
+int
+main(int argc, const char* argv[])
+{
+    if (argc < 5)
+    {
+        fmt::print(
+            stderr, "Usage: {} <dimension> <whites> <blacks> <directory> [threads]\n", argv[0]);
+        return 1;
+    }
+
+    auto dimension = static_cast<unsigned>(std::stoul(argv[1]));
+    auto whites = static_cast<unsigned>(std::stoul(argv[2]));
+    auto blacks = static_cast<unsigned>(std::stoul(argv[3]));
+    std::string directory = argv[4];
+    auto threads = argc > 5 ? static_cast<unsigned>(std::stoul(argv[5]))
+                            : std::max(std::thread::hardware_concurrency(), 1u);
+
+    if (dimension > Tablebases::kMaxDimension || whites > Tablebases::kMaxPieces ||
+        blacks > Tablebases::kMaxPieces)
+    {
+        fmt::print(stderr,
+                   "At most a {}x{} board and {} pieces of each color\n",
+                   Tablebases::kMaxDimension,
+                   Tablebases::kMaxDimension,
+                   Tablebases::kMaxPieces);
+        return 1;
+    }
+
+    auto size = Tablebases::generatedSize(dimension, whites, blacks);
+    if (size > Tablebases::kMaxGeneratedSize)
+    {
+        fmt::print(stderr,
+                   "The tablebases would take {} MB, more than the {} MB allowed\n",
+                   size >> 20,
+                   Tablebases::kMaxGeneratedSize >> 20);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!Tablebases::generate(dimension, whites, blacks, directory, threads))
+    {
+        fmt::print(stderr, "Failed to write the tablebases to {}\n", directory);
+        return 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    fmt::print("Generated {}x{} tablebases up to {} white and {} black pieces in {} ms\n",
+               dimension,
+               dimension,
+               whites,
+               blacks,
+               elapsed.count());
+
+    return 0;
+}
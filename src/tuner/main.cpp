@@ -0,0 +1,125 @@
+#include <Evaluation.hpp>
+#include <EvaluationTuner.hpp>
+#include <GameRecords.hpp>
+#include <chrono>
+#include <fmt/format.h>
+#include <string>
+#include <vector>
+
+using namespace tafl;
+
+/*
+ * Tune the weights of the evaluation on the positions of recorded games, and write them
+ * to a file for the engine to load.
+ *
+ *   tuner [--threads n] [--epochs n] [--rate r] [--skip-plies n] [--start file]
+ *         [--output file] records...
+ *
+ * The tuning starts from the weights of the start file, or from the default weights.
+ * The weights are written to weights.txt without an output file.
+ */
+int
+main(int argc, const char* argv[])
+{
+    TunerConfig config;
+    auto skipPlies = 4u;
+    std::string startPath;
+    std::string outputPath = "weights.txt";
+    std::vector<std::string> records;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto hasValue = i + 1 < argc;
+
+        if (arg == "--threads" && hasValue)
+        {
+            config.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--epochs" && hasValue)
+        {
+            config.epochs = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--rate" && hasValue)
+        {
+            config.learningRate = std::stof(argv[++i]);
+        }
+        else if (arg == "--skip-plies" && hasValue)
+        {
+            skipPlies = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--start" && hasValue)
+        {
+            startPath = argv[++i];
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            outputPath = argv[++i];
+        }
+        else if (!arg.starts_with("--"))
+        {
+            records.push_back(arg);
+        }
+        else
+        {
+            records.clear();
+            break;
+        }
+    }
+
+    if (records.empty())
+    {
+        fmt::print(stderr,
+                   "Usage: {} [--threads n] [--epochs n] [--rate r] [--skip-plies n] "
+                   "[--start file] [--output file] records...\n",
+                   argv[0]);
+        return 1;
+    }
+
+    Evaluation start;
+    if (!startPath.empty())
+    {
+        auto loaded = Evaluation::load(startPath);
+        if (!loaded)
+        {
+            fmt::print(stderr, "Failed to load the weights from {}\n", startPath);
+            return 1;
+        }
+        start = *loaded;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    auto seconds = [&begin]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    };
+
+    EvaluationTuner tuner;
+    for (auto& path : records)
+    {
+        auto reader = GameRecordReader::open(path);
+        if (!reader || !reader->verify())
+        {
+            fmt::print(stderr, "Failed to read the games of {}\n", path);
+            return 1;
+        }
+        tuner.addGames(*reader, config.threads, skipPlies);
+    }
+    fmt::print("{} positions read in {:.1f} s\n", tuner.getPositionCount(), seconds());
+
+    auto tuned = tuner.tune(start, config, [&](unsigned epoch, double loss) {
+        if (epoch == 1 || epoch % 50 == 0)
+        {
+            fmt::print("Epoch {}: loss {:.5f} at {:.1f} s\n", epoch, loss, seconds());
+        }
+    });
+    fmt::print("Final loss {:.5f}\n", tuner.getLoss(tuned, config.threads));
+
+    if (!tuned.save(outputPath))
+    {
+        fmt::print(stderr, "Failed to write the weights to {}\n", outputPath);
+        return 1;
+    }
+    fmt::print("{}", tuned.toText());
+
+    return 0;
+}
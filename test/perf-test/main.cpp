@@ -0,0 +1,269 @@
+#include <IBoard.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace tafl;
+
+namespace
+{
+
+// The best of a few runs is compared, which filters out most of the noise
+constexpr auto kRuns = 3u;
+constexpr auto kDefaultTolerance = 0.2;
+// The exit code which ctest reports as a skipped test
+constexpr auto kSkipped = 77;
+
+struct Workload
+{
+    const char* name;
+    // Runs the workload and returns the work done, which must match the baseline
+    std::function<uint64_t()> run;
+    // Does the work done depend on the search, rather than only on the rules?
+    bool searched;
+};
+
+struct Measurement
+{
+    uint64_t count {0};
+    // The work done per second
+    double rate {0};
+};
+
+std::unique_ptr<IBoard>
+createBoard(const std::string& s, Color turn)
+{
+    auto board = IBoard::fromString(s);
+    board->setTurn(turn);
+
+    return board;
+}
+
+// The number of move sequences of a depth, with the moves of the last ply only counted
+uint64_t
+perft(const IBoard& board, unsigned depth)
+{
+    if (board.getWinner())
+    {
+        return 0;
+    }
+
+    std::array<Move, 512> buffer;
+    auto moves = board.getPossibleMoves(buffer);
+    if (depth == 1)
+    {
+        return moves.size();
+    }
+
+    uint64_t out = 0;
+    for (auto& move : moves)
+    {
+        auto child = board.clone();
+
+        child->move(move);
+        out += perft(*child, depth - 1);
+    }
+
+    return out;
+}
+
+// Seeded single-threaded playouts, so that the same tree is searched every time
+uint64_t
+playouts(const std::string& s, Color turn, uint64_t budget)
+{
+    auto board = createBoard(s, turn);
+
+    SearchConfig config;
+    config.threads = 1;
+    config.playouts = budget;
+    config.seed = 1;
+
+    return board->search(config).get().playouts;
+}
+
+const auto kWorkloads = std::array {
+    Workload {"perft-tablut-4",
+              []() { return perft(*createBoard(kTablut, Color::Black), 4); },
+              false},
+    Workload {"perft-brandubh-4",
+              []() { return perft(*createBoard(kBrandubh, Color::Black), 4); },
+              false},
+    Workload {"playouts-tablut", []() { return playouts(kTablut, Color::Black, 10000); }, true},
+    Workload {"playouts-brandubh",
+              []() { return playouts(kBrandubh, Color::Black, 20000); },
+              true},
+};
+
+Measurement
+measure(const Workload& workload)
+{
+    Measurement out;
+
+    for (auto run = 0u; run < kRuns; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        out.count = workload.run();
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+        out.rate = std::max(out.rate, out.count / std::max(elapsed.count(), 1e-9));
+    }
+
+    return out;
+}
+
+// The lines of a baseline file are "<workload> <count> <rate>", and # starts a comment
+std::map<std::string, Measurement>
+readBaseline(const std::string& path)
+{
+    std::map<std::string, Measurement> out;
+    std::ifstream in(path);
+
+    for (std::string line; std::getline(in, line);)
+    {
+        std::istringstream fields(line);
+        std::string name;
+        Measurement measurement;
+
+        if (line.starts_with('#') || !(fields >> name >> measurement.count >> measurement.rate))
+        {
+            continue;
+        }
+        out[name] = measurement;
+    }
+
+    return out;
+}
+
+bool
+writeBaseline(const std::string& path, const std::map<std::string, Measurement>& measurements)
+{
+    std::ofstream out(path, std::ios::trunc);
+
+    out << "# The throughput of the perf-test workloads on the build machine, in work per\n"
+           "# second. Regenerate with the perf-baseline target after a deliberate change.\n"
+           "# <workload> <count> <rate>\n";
+    for (auto& [name, measurement] : measurements)
+    {
+        out << fmt::format("{} {} {:.0f}\n", name, measurement.count, measurement.rate);
+    }
+
+    return out.good();
+}
+
+} // namespace
+
+/*
+ * Run fixed workloads on the release library and compare their throughput with a
+ * baseline. Fails if a workload is slower than the baseline by more than the tolerance,
+ * or if the work done by a rules-only workload differs.
+ *
+ *   perf-test <baseline-file> [--update] [--tolerance <fraction>]
+ *
+ * With --update, the baseline file is rewritten with the current measurements. Without,
+ * the test is skipped if there is no baseline file yet.
+ */
+int
+main(int argc, const char* argv[])
+{
+    if (argc < 2)
+    {
+        fmt::print(
+            stderr, "Usage: {} <baseline-file> [--update] [--tolerance <fraction>]\n", argv[0]);
+        return 1;
+    }
+
+    const std::string path = argv[1];
+    auto update = false;
+    auto tolerance = kDefaultTolerance;
+    for (auto i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--update")
+        {
+            update = true;
+        }
+        else if (arg == "--tolerance" && i + 1 < argc)
+        {
+            tolerance = std::stod(argv[++i]);
+        }
+    }
+
+    if (!update && !std::filesystem::exists(path))
+    {
+        fmt::print("No baseline at {}, measure one with --update\n", path);
+        return kSkipped;
+    }
+
+    auto baseline = readBaseline(path);
+    std::map<std::string, Measurement> measurements;
+    auto failures = 0u;
+
+    fmt::print("{:<20} {:>12} {:>12} {:>12} {:>8}\n",
+               "workload",
+               "count",
+               "rate",
+               "baseline",
+               "change");
+    for (auto& workload : kWorkloads)
+    {
+        auto measurement = measure(workload);
+        measurements[workload.name] = measurement;
+
+        auto expected = baseline.find(workload.name);
+        if (expected == baseline.end())
+        {
+            fmt::print("{:<20} {:>12} {:>12.0f} {:>12} {:>8}\n",
+                       workload.name,
+                       measurement.count,
+                       measurement.rate,
+                       "-",
+                       "new");
+            continue;
+        }
+
+        auto change = measurement.rate / expected->second.rate - 1;
+        auto slower = change < -tolerance;
+        auto differs = !workload.searched && measurement.count != expected->second.count;
+
+        fmt::print("{:<20} {:>12} {:>12.0f} {:>12.0f} {:>+7.1f}%{}\n",
+                   workload.name,
+                   measurement.count,
+                   measurement.rate,
+                   expected->second.rate,
+                   change * 100,
+                   differs ? " count differs" : slower ? " too slow" : "");
+        if (!update && (slower || differs))
+        {
+            failures++;
+        }
+    }
+
+    if (update)
+    {
+        if (!writeBaseline(path, measurements))
+        {
+            fmt::print(stderr, "Failed to write {}\n", path);
+            return 1;
+        }
+        fmt::print("Updated {}\n", path);
+
+        return 0;
+    }
+
+    if (failures)
+    {
+        fmt::print("{} workloads regressed by more than {:.0f}%\n", failures, tolerance * 100);
+        return 1;
+    }
+
+    return 0;
+}
@@ -4,6 +4,7 @@
 
 #include <IBoard.hpp>
 #include <Pos.hpp>
+#include <functional>
 
 namespace tafl::ut
 {
@@ -61,4 +62,40 @@ parse(const std::string& s)
     return out;
 }
 
+/*
+ * Play random moves until there is a winner, no possible move or maxPlies moves, the same
+ * moves for the same seed. onMove is called with each move before it's played.
+ *
+ * Returns the number of pieces captured.
+ */
+static unsigned
+playRandomGame(IBoard& board,
+               uint32_t seed,
+               unsigned maxPlies,
+               const std::function<void(const Move& move)>& onMove)
+{
+    auto pieces = [&board]() {
+        return board.getPieceCount(Color::Black) + board.getPieceCount(Color::White);
+    };
+    auto random = seed;
+    auto captures = 0u;
+
+    for (auto ply = 0u; ply < maxPlies && !board.getWinner(); ply++)
+    {
+        random = random * 1664525 + 1013904223;
+        auto move = board.getRandomMove(random >> 8);
+        if (!move)
+        {
+            break;
+        }
+
+        onMove(*move);
+        auto before = pieces();
+        board.move(*move);
+        captures += before - pieces();
+    }
+
+    return captures;
+}
+
 } // namespace tafl::ut
@@ -27,15 +27,37 @@ public:
     MAKE_CONST_MOCK0(getBoardDimension, unsigned(), override);
     MAKE_CONST_MOCK1(pieceAt, std::optional<Piece::Type>(const Pos& pos), override);
     MAKE_CONST_MOCK1(getPieces, std::vector<Piece>(const Color& which), override);
+    MAKE_CONST_MOCK2(getPieces,
+                     std::span<Piece>(const Color& which, std::span<Piece> out),
+                     override);
     MAKE_CONST_MOCK0(getPossibleMoves, std::vector<Move>(), override);
+    MAKE_CONST_MOCK1(getPossibleMoves, std::span<Move>(std::span<Move> out), override);
+    MAKE_CONST_MOCK1(getRandomMove, std::optional<Move>(uint32_t random), override);
+    MAKE_CONST_MOCK1(getKingEscapes, std::span<Move>(std::span<Move> out), override);
+    MAKE_CONST_MOCK1(getBlockingMove, std::optional<Move>(uint32_t random), override);
+    MAKE_CONST_MOCK1(getPieceCount, unsigned(const Color& which), override);
+    MAKE_CONST_MOCK0(getKingPosition, std::optional<Pos>(), override);
     MAKE_MOCK1(move, void(Move move), override);
     MAKE_CONST_MOCK0(getTurn, Color(), override);
     MAKE_MOCK1(setTurn, void(Color which), override);
+    MAKE_CONST_MOCK0(clone, std::unique_ptr<IBoard>(), override);
+    MAKE_MOCK2(setPosition, bool(std::span<const Piece::Type> squares, Color turn), override);
+    MAKE_MOCK1(attachNetwork, bool(const NeuralNetwork* network), override);
+    MAKE_CONST_MOCK0(getNetworkScore, std::optional<float>(), override);
+    MAKE_MOCK1(attachPatterns, void(bool attach), override);
+    MAKE_CONST_MOCK1(getPattern, std::optional<uint16_t>(const Pos& pos), override);
     MAKE_CONST_MOCK0(getWinner, std::optional<Color>(), override);
     MAKE_MOCK2(calculateBestMove,
                std::future<std::optional<Move>>(const std::chrono::milliseconds& quota,
                                                 std::function<void()> onFutureReady),
                override);
+    MAKE_MOCK1(search, std::future<SearchResult>(const SearchConfig& config), override);
+    MAKE_CONST_MOCK1(prove, ProofResult(const ProofConfig& config), override);
+    MAKE_CONST_MOCK0(probeTablebase, std::optional<TablebaseResult>(), override);
+    MAKE_CONST_MOCK3(visitPieces,
+                     void(const Color& which, Visitor<Piece> visitor, void* context),
+                     override);
+    MAKE_CONST_MOCK2(visitPossibleMoves, void(Visitor<Move> visitor, void* context), override);
 
 
 private:
@@ -0,0 +1,81 @@
+#include "tests.hpp"
+
+#include <BatchAnalysis.hpp>
+#include <IBoard.hpp>
+#include <PositionFormat.hpp>
+#include <map>
+#include <sstream>
+
+using namespace tafl;
+
+SCENARIO("a batch of positions is analysed")
+{
+    std::stringstream input;
+    input << "# an archive\n"
+          << kBrandubh << ";b\n"
+          << "\n"
+          << "not a board\n"
+          << kTablut << ";w\n";
+
+    BatchConfig config;
+    config.threads = 2;
+    config.playouts = 500;
+    config.seed = 7;
+
+    std::map<uint64_t, BatchResult> results;
+    auto analysed = BatchAnalysis::run(
+        input, config, [&results](const BatchResult& r) { results[r.index] = r; });
+
+    THEN("each position gives a result, with the line it was read from")
+    {
+        REQUIRE(analysed == 3);
+        REQUIRE(results.size() == 3);
+        REQUIRE(results[1].search.bestMove);
+        REQUIRE(results[1].search.playouts == config.playouts);
+        REQUIRE(results[3].error);
+        REQUIRE(results[4].search.bestMove);
+    }
+
+    THEN("the results are formatted as JSON lines")
+    {
+        auto json = BatchAnalysis::toJson(results[1], 3);
+
+        REQUIRE(json.starts_with("{\"index\":1,\"bestMove\":{\"from\":["));
+        REQUIRE(json.find('\n') == std::string::npos);
+        REQUIRE(BatchAnalysis::toJson(results[3], 3) ==
+                "{\"index\":3,\"error\":\"invalid position\"}");
+    }
+}
+
+SCENARIO("a batch of packed positions is analysed")
+{
+    std::stringstream input;
+    auto header = PositionFormat::header(7);
+    input.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    for (auto turn : {Color::Black, Color::White})
+    {
+        auto board = IBoard::fromString(kBrandubh);
+        board->setTurn(turn);
+
+        std::array<uint8_t, PositionFormat::packedSize(7)> packed;
+        REQUIRE(PositionFormat::pack(*board, packed));
+        input.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    }
+
+    BatchConfig config;
+    config.threads = 2;
+    config.playouts = 300;
+
+    std::map<uint64_t, BatchResult> results;
+    auto analysed = BatchAnalysis::run(
+        input, config, [&results](const BatchResult& r) { results[r.index] = r; });
+
+    THEN("each record gives a result")
+    {
+        REQUIRE(analysed == 2);
+        REQUIRE(results[0].search.bestMove);
+        REQUIRE(results[1].search.bestMove);
+        REQUIRE_FALSE(results[0].error);
+    }
+}
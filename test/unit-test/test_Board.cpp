@@ -2,7 +2,10 @@
 #include "tests.hpp"
 
 #include <IBoard.hpp>
+#include <algorithm>
+#include <array>
 #include <map>
+#include <random>
 
 using namespace tafl;
 using namespace tafl::ut;
@@ -322,3 +325,310 @@ SCENARIO("the winner of a board can be evaluated")
         REQUIRE(b4->board->getWinner() == Color::White);
     }
 }
+
+SCENARIO("boards can be queried without allocations")
+{
+    auto b = IBoard::fromString(kTablut);
+    REQUIRE(b);
+
+    THEN("the piece counts and king position are available directly")
+    {
+        REQUIRE(b->getPieceCount(Color::Black) == 16);
+        REQUIRE(b->getPieceCount(Color::White) == 9);
+        REQUIRE(b->getKingPosition() == Pos {4, 4});
+    }
+
+    THEN("pieces can be copied into a caller-provided buffer")
+    {
+        std::array<Piece, 18 * 18> buf;
+        std::array<Piece, 4> small;
+
+        auto black = b->getPieces(Color::Black, buf);
+        auto truncated = b->getPieces(Color::Black, small);
+
+        REQUIRE(black.size() == 16);
+        REQUIRE(truncated.size() == 4);
+        for (auto& p : black)
+        {
+            REQUIRE(p.getColor() == Color::Black);
+        }
+    }
+
+    THEN("the possible moves can be copied into a caller-provided buffer")
+    {
+        std::array<Move, 18 * 18 * 18> buf;
+
+        auto expected = b->getPossibleMoves();
+        auto moves = b->getPossibleMoves(buf);
+
+        REQUIRE(moves.size() == expected.size());
+        REQUIRE(std::equal(moves.begin(), moves.end(), expected.begin()));
+    }
+
+    THEN("pieces and moves can be visited")
+    {
+        auto nWhite = 0u;
+        auto nMoves = 0u;
+
+        b->forEachPiece(Color::White, [&nWhite](const Piece& p) {
+            REQUIRE(p.getColor() == Color::White);
+            nWhite++;
+        });
+        b->forEachPossibleMove([&nMoves](const Move&) { nMoves++; });
+
+        REQUIRE(nWhite == 9);
+        REQUIRE(nMoves == b->getPossibleMoves().size());
+    }
+
+    WHEN("pieces are captured")
+    {
+        const std::string kingTakenBoard = "     "
+                                           "bk. B"
+                                           "   w "
+                                           "     "
+                                           "     ";
+        auto h = parse(kingTakenBoard);
+        h->board->setTurn(Color::Black);
+        h->board->move(*h->move);
+
+        THEN("the counts and king position are updated")
+        {
+            REQUIRE(h->board->getPieceCount(Color::Black) == 2);
+            REQUIRE(h->board->getPieceCount(Color::White) == 1);
+            REQUIRE(h->board->getKingPosition() == std::nullopt);
+        }
+    }
+}
+
+SCENARIO("random moves can be selected without the list of moves")
+{
+    auto b = IBoard::fromString(kTablut);
+    REQUIRE(b);
+
+    THEN("each random value selects the corresponding possible move")
+    {
+        for (auto turn : {Color::White, Color::Black})
+        {
+            b->setTurn(turn);
+            auto moves = b->getPossibleMoves();
+            REQUIRE_FALSE(moves.empty());
+
+            for (auto i = 0u; i < moves.size() * 2; i++)
+            {
+                auto m = b->getRandomMove(i);
+
+                REQUIRE(m);
+                REQUIRE(*m == moves[i % moves.size()]);
+            }
+        }
+    }
+
+    THEN("the selected moves are uniformly distributed")
+    {
+        const auto samplesPerMove = 200u;
+        std::mt19937 rng(1234);
+
+        for (auto turn : {Color::White, Color::Black})
+        {
+            b->setTurn(turn);
+            auto moves = b->getPossibleMoves();
+            std::map<unsigned, unsigned> hits;
+
+            for (auto i = 0u; i < moves.size() * samplesPerMove; i++)
+            {
+                auto m = b->getRandomMove(rng());
+                REQUIRE(m);
+
+                auto it = std::find(moves.begin(), moves.end(), *m);
+                REQUIRE(it != moves.end());
+                hits[it - moves.begin()]++;
+            }
+
+            // Chi-squared test, with a very generous limit
+            auto chi2 = 0.0;
+            for (auto i = 0u; i < moves.size(); i++)
+            {
+                auto d = static_cast<double>(hits[i]) - samplesPerMove;
+                chi2 += d * d / samplesPerMove;
+            }
+            REQUIRE(hits.size() == moves.size());
+            REQUIRE(chi2 < 2.0 * moves.size());
+        }
+    }
+
+    THEN("there is no move if no piece can move")
+    {
+        auto blocked = IBoard::fromString("bw "
+                                          "w  "
+                                          "  k");
+        blocked->setTurn(Color::Black);
+
+        REQUIRE(blocked->getRandomMove(0) == std::nullopt);
+    }
+}
+
+SCENARIO("the escape routes of the king can be found")
+{
+    std::array<Move, 4> buf;
+
+    THEN("a king without open lines has no escapes")
+    {
+        auto b = IBoard::fromString(kTablut);
+
+        REQUIRE(b->getKingEscapes(buf).empty());
+    }
+
+    THEN("open lines to the edges are escapes")
+    {
+        const std::string twoEscapes = "  b  "
+                                       "     "
+                                       " k  b"
+                                       "     "
+                                       " w   ";
+        auto b = IBoard::fromString(twoEscapes);
+        auto escapes = b->getKingEscapes(buf);
+
+        REQUIRE(escapes.size() == 2);
+        REQUIRE(std::count(escapes.begin(), escapes.end(), Move {{1, 2}, {0, 2}}) == 1);
+        REQUIRE(std::count(escapes.begin(), escapes.end(), Move {{1, 2}, {1, 0}}) == 1);
+    }
+
+    THEN("the castle blocks escapes")
+    {
+        const std::string castleBlocked = "     "
+                                          " b   "
+                                          " k   "
+                                          " b   "
+                                          "     ";
+        auto b = IBoard::fromString(castleBlocked);
+        auto escapes = b->getKingEscapes(buf);
+
+        REQUIRE(escapes.size() == 1);
+        REQUIRE(escapes[0] == Move {{1, 2}, {0, 2}});
+    }
+}
+
+SCENARIO("black blocks or captures the king when it could escape")
+{
+    std::array<Move, 4> buf;
+
+    THEN("each move which blocks the only open line or captures the king is selected")
+    {
+        // The king can only escape to the left, and black captures it on (2, 2)
+        const std::string oneEscape = "  b    "
+                                      "  k w  "
+                                      "      b"
+                                      "       "
+                                      "  w    "
+                                      " b     "
+                                      "b      ";
+        auto b = IBoard::fromString(oneEscape);
+        b->setTurn(Color::Black);
+        REQUIRE(b->getKingEscapes(buf).size() == 1);
+
+        const std::array<Move, 3> candidates {
+            Move {{1, 5}, {1, 1}}, Move {{0, 6}, {0, 1}}, Move {{6, 2}, {2, 2}}};
+        std::array<unsigned, 3> hits {};
+
+        for (auto random = 0u; random < 300; random++)
+        {
+            auto m = b->getBlockingMove(random * 0x9e3779b9u);
+            REQUIRE(m);
+
+            auto it = std::find(candidates.begin(), candidates.end(), *m);
+            REQUIRE(it != candidates.end());
+            hits[it - candidates.begin()]++;
+
+            auto after = b->clone();
+            after->move(*m);
+            REQUIRE((after->getWinner() == Color::Black || after->getKingEscapes(buf).empty()));
+        }
+
+        for (auto count : hits)
+        {
+            // 100 each if the selection is uniform
+            REQUIRE(count > 50);
+        }
+    }
+
+    THEN("the king on the castle is captured from all four sides only")
+    {
+        const std::string threeSides = "       "
+                                       "   w   "
+                                       "       "
+                                       "  bk w "
+                                       "   b   "
+                                       "       "
+                                       "    b  ";
+        auto b = IBoard::fromString(threeSides);
+        b->setTurn(Color::Black);
+
+        REQUIRE(b->getKingEscapes(buf).empty());
+        REQUIRE(b->getBlockingMove(0) == std::nullopt);
+
+        const std::string fourSides = "       "
+                                      "   w   "
+                                      "   b   "
+                                      "  bk w "
+                                      "   b   "
+                                      "       "
+                                      "    b  ";
+        b = IBoard::fromString(fourSides);
+        b->setTurn(Color::Black);
+
+        for (auto random : {0u, 12345u, 0xffffffffu})
+        {
+            REQUIRE(b->getBlockingMove(random) == Move {{4, 6}, {4, 3}});
+        }
+
+        b->move(Move {{4, 6}, {4, 3}});
+        REQUIRE(b->getWinner() == Color::Black);
+    }
+
+    THEN("there is no move against two open lines, or for white")
+    {
+        const std::string twoEscapes = "  b  "
+                                       "     "
+                                       " k  b"
+                                       "     "
+                                       " w   ";
+        auto b = IBoard::fromString(twoEscapes);
+        b->setTurn(Color::Black);
+
+        REQUIRE(b->getBlockingMove(0) == std::nullopt);
+
+        b = IBoard::fromString(kBrandubh);
+        b->setTurn(Color::White);
+        REQUIRE(b->getBlockingMove(0) == std::nullopt);
+    }
+}
+
+SCENARIO("boards can be copied")
+{
+    auto b = IBoard::fromString(smallBoard);
+    b->setTurn(Color::Black);
+
+    auto copy = b->clone();
+
+    THEN("the copy has the same position and turn")
+    {
+        REQUIRE(copy->getTurn() == Color::Black);
+        REQUIRE(copy->getPossibleMoves() == b->getPossibleMoves());
+        REQUIRE(copy->getPieceCount(Color::White) == b->getPieceCount(Color::White));
+        REQUIRE(copy->getPieceCount(Color::Black) == b->getPieceCount(Color::Black));
+    }
+
+    AND_WHEN("the copy is moved")
+    {
+        copy->move(copy->getPossibleMoves().front());
+
+        THEN("the original is unchanged")
+        {
+            REQUIRE(b->getTurn() == Color::Black);
+            REQUIRE(copy->getTurn() == Color::White);
+
+            copy->setTurn(Color::Black);
+            REQUIRE(copy->getPossibleMoves() != b->getPossibleMoves());
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#include "BoardHelper.hpp"
+#include "tests.hpp"
+
+#include <Evaluation.hpp>
+#include <EvaluationTuner.hpp>
+#include <IBoard.hpp>
+#include <PositionFormat.hpp>
+#include <cmath>
+
+using namespace tafl;
+using namespace tafl::ut;
+
+namespace
+{
+
+// Long enough for the random games to end
+constexpr auto kMaxPlies = 10000u;
+
+// Random games from a position, with each position and the winner of its game
+void
+addRandomGames(EvaluationTuner& tuner, const IBoard& start, unsigned games)
+{
+    for (auto game = 0u; game < games; game++)
+    {
+        auto board = start.clone();
+        std::vector<std::unique_ptr<IBoard>> positions;
+
+        playRandomGame(*board, game + 1, kMaxPlies, [&](const Move&) {
+            positions.push_back(board->clone());
+        });
+
+        if (auto winner = board->getWinner())
+        {
+            for (auto& position : positions)
+            {
+                tuner.addPosition(*position, *winner);
+            }
+        }
+    }
+}
+
+} // namespace
+
+SCENARIO("positions are evaluated by their features")
+{
+    auto board = IBoard::fromString(kTablut);
+    board->setTurn(Color::Black);
+
+    THEN("the features are counted")
+    {
+        auto features = Evaluation::extract(*board);
+
+        REQUIRE(features[Evaluation::Bias] == 1);
+        REQUIRE(features[Evaluation::Tempo] == -1);
+        REQUIRE(features[Evaluation::BlackPieces] == 16);
+        REQUIRE(features[Evaluation::WhitePieces] == 8);
+        REQUIRE(features[Evaluation::KingEdgeDistance] == 4);
+        REQUIRE(features[Evaluation::KingEscapes] == 0);
+        REQUIRE(features[Evaluation::KingMobility] == 0);
+        REQUIRE(features[Evaluation::KingAttackers] == 0);
+        REQUIRE(features[Evaluation::KingDefenders] == 4);
+    }
+
+    THEN("a king with open lines to the edges is likely to win")
+    {
+        auto open = PositionFormat::fromText("  b      "
+                                             "         "
+                                             "         "
+                                             "         "
+                                             "   k     "
+                                             "         "
+                                             "         "
+                                             "      b  "
+                                             "         ;w");
+        REQUIRE(open);
+
+        Evaluation evaluation;
+        auto features = Evaluation::extract(*open);
+
+        REQUIRE(features[Evaluation::KingEscapes] >= 2);
+        REQUIRE(features[Evaluation::KingMobility] == 16);
+        REQUIRE(evaluation.winRate(*open, Color::White) > 0.5f);
+        REQUIRE(evaluation.winRate(*open, Color::White) ==
+                doctest::Approx(1 - evaluation.winRate(*open, Color::Black)));
+    }
+
+    THEN("the weights are written and read back")
+    {
+        Evaluation::Weights weights;
+        for (auto i = 0u; i < Evaluation::kFeatures; i++)
+        {
+            weights[i] = 0.25f * i - 1.0f / 3;
+        }
+
+        auto text = "# tuned\n" + Evaluation(weights).toText();
+        auto read = Evaluation::fromText(text);
+
+        REQUIRE(read);
+        REQUIRE(read->getWeights() == weights);
+        REQUIRE_FALSE(Evaluation::fromText("bias 1\ntempo 2\n"));
+        REQUIRE_FALSE(Evaluation::fromText("bias one\n"));
+    }
+
+    THEN("a search can score its playouts with the evaluation")
+    {
+        SearchConfig config;
+        config.threads = 2;
+        config.playouts = 2000;
+        config.evaluation = std::make_shared<Evaluation>();
+        config.playoutDepth = 8;
+
+        auto result = board->search(config).get();
+
+        REQUIRE(result.bestMove);
+        REQUIRE(result.playouts == config.playouts);
+    }
+}
+
+SCENARIO("the weights are tuned on played games")
+{
+    EvaluationTuner tuner;
+    addRandomGames(tuner, *IBoard::fromString(kBrandubh), 200);
+
+    REQUIRE(tuner.getPositionCount() > 1000);
+
+    Evaluation::Weights zero {};
+    TunerConfig config;
+    config.threads = 3;
+    config.epochs = 150;
+
+    auto before = tuner.getLoss(Evaluation(zero), config.threads);
+    auto epochs = 0u;
+    auto tuned = tuner.tune(Evaluation(zero), config, [&epochs](unsigned, double) { epochs++; });
+
+    THEN("the loss is lower")
+    {
+        REQUIRE(epochs == config.epochs);
+        REQUIRE(before == doctest::Approx(std::log(2.0)));
+        REQUIRE(tuner.getLoss(tuned, config.threads) < before);
+        REQUIRE(tuner.getLoss(tuned, 1) == doctest::Approx(tuner.getLoss(tuned, 3)));
+    }
+}
@@ -0,0 +1,228 @@
+#include "BoardHelper.hpp"
+#include "tests.hpp"
+
+#include <GameRecords.hpp>
+#include <IBoard.hpp>
+#include <PositionFormat.hpp>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace tafl;
+using namespace tafl::ut;
+
+namespace
+{
+
+// Random games from the starting position, with their moves and winners
+std::vector<std::pair<std::vector<Move>, std::optional<Color>>>
+playGames(const IBoard& start, unsigned games)
+{
+    std::vector<std::pair<std::vector<Move>, std::optional<Color>>> out;
+
+    for (auto game = 0u; game < games; game++)
+    {
+        auto board = start.clone();
+        std::vector<Move> moves;
+
+        playRandomGame(*board, game + 1, 200, [&moves](const Move& move) {
+            moves.push_back(move);
+        });
+        out.push_back({moves, board->getWinner()});
+    }
+
+    return out;
+}
+
+} // namespace
+
+SCENARIO("games are recorded and read back")
+{
+    auto path = std::filesystem::temp_directory_path() / "tafl-test-games.bin";
+    std::filesystem::remove(path);
+
+    auto start = IBoard::fromString(kTablut);
+    start->setTurn(Color::Black);
+    auto games = playGames(*start, 600);
+
+    // Two writers, so that the second one appends
+    for (auto half : {0u, 1u})
+    {
+        auto writer = GameRecordWriter::open(path.string(), "tablut", *start);
+        REQUIRE(writer);
+
+        for (auto i = half * 300; i < (half + 1) * 300; i++)
+        {
+            REQUIRE(writer->add(games[i].first, games[i].second));
+        }
+    }
+
+    auto reader = GameRecordReader::open(path.string());
+    REQUIRE(reader);
+
+    THEN("the header and the games are the same")
+    {
+        REQUIRE(reader->getVariant() == "tablut");
+        REQUIRE(reader->getDimension() == 9);
+        REQUIRE(PositionFormat::toText(*reader->getStart()) == PositionFormat::toText(*start));
+        REQUIRE(reader->getGameCount() == games.size());
+        REQUIRE(reader->verify());
+
+        for (auto i : {0u, 1u, 299u, 300u, 451u, 599u})
+        {
+            auto game = reader->getGame(i);
+            REQUIRE(game);
+
+            REQUIRE(game->getPlies() == games[i].first.size());
+            REQUIRE(game->getWinner() == games[i].second);
+            for (auto ply = 0u; ply < game->getPlies(); ply++)
+            {
+                REQUIRE(game->getMove(ply) == games[i].first[ply]);
+            }
+        }
+        REQUIRE_FALSE(reader->getGame(games.size()));
+    }
+
+    THEN("all games and positions are visited by several threads")
+    {
+        uint64_t expected = 0;
+        for (auto& game : games)
+        {
+            expected += game.first.size() + 1;
+        }
+
+        std::atomic<uint64_t> visitedGames {0};
+        std::atomic<uint64_t> positions {0};
+        std::atomic<uint64_t> mismatches {0};
+
+        reader->forEachGame(3, [&](uint64_t index, const GameView& game) {
+            visitedGames++;
+            mismatches += game.getPlies() != games[index].first.size();
+        });
+        reader->forEachPosition(3, [&](const IBoard& board, const GameView& game, unsigned ply) {
+            positions++;
+            mismatches += ply == game.getPlies() && board.getWinner() != game.getWinner();
+        });
+
+        REQUIRE(visitedGames == games.size());
+        REQUIRE(reader->getPositionCount() == expected);
+        REQUIRE(positions == expected);
+        REQUIRE(mismatches == 0);
+    }
+
+    AND_WHEN("the last block is cut short")
+    {
+        reader.reset();
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+
+        THEN("it's ignored by the reader, and overwritten by the next writer")
+        {
+            auto truncated = GameRecordReader::open(path.string());
+            REQUIRE(truncated);
+            REQUIRE(truncated->getGameCount() < games.size());
+            REQUIRE(truncated->verify());
+
+            auto count = truncated->getGameCount();
+            truncated.reset();
+
+            GameRecordWriter::open(path.string(), "tablut", *start)
+                ->add(games[0].first, games[0].second);
+
+            auto appended = GameRecordReader::open(path.string());
+            REQUIRE(appended->getGameCount() == count + 1);
+            REQUIRE(appended->verify());
+        }
+    }
+
+    AND_WHEN("a byte of the first block is damaged")
+    {
+        reader.reset();
+
+        // The number of moves of the first game, after the file and block headers
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(148);
+            file.put(static_cast<char>(0xff));
+            file.put(static_cast<char>(0xff));
+        }
+
+        THEN("the block is skipped when it's read, and the rest can still be read")
+        {
+            auto damaged = GameRecordReader::open(path.string());
+            REQUIRE(damaged);
+            REQUIRE(damaged->getGameCount() == games.size());
+            REQUIRE_FALSE(damaged->getGame(0));
+            REQUIRE(damaged->getGame(games.size() - 1)->getPlies() == games.back().first.size());
+
+            std::atomic<uint64_t> positions {0};
+            damaged->forEachPosition(
+                2, [&](const IBoard&, const GameView&, unsigned) { positions++; });
+
+            REQUIRE(positions > 0);
+            REQUIRE(positions < damaged->getPositionCount());
+            REQUIRE_FALSE(damaged->verify());
+        }
+    }
+
+    AND_WHEN("the header of the second block is damaged")
+    {
+        reader.reset();
+
+        // The magic of the header after the games of the first block
+        auto size = std::filesystem::file_size(path);
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            uint64_t blockSize;
+            file.seekg(116 + 8);
+            file.read(reinterpret_cast<char*>(&blockSize), sizeof(blockSize));
+            file.seekp(static_cast<std::streamoff>(116 + 32 + blockSize));
+            file.put('X');
+        }
+
+        THEN("the blocks before it are read, and it isn't appended to")
+        {
+            auto damaged = GameRecordReader::open(path.string());
+            REQUIRE(damaged);
+            REQUIRE(damaged->getGameCount() > 0);
+            REQUIRE(damaged->getGameCount() < games.size());
+            REQUIRE(damaged->getGame(0));
+            REQUIRE_FALSE(damaged->verify());
+
+            REQUIRE_FALSE(GameRecordWriter::open(path.string(), "tablut", *start));
+            REQUIRE(std::filesystem::file_size(path) == size);
+        }
+    }
+
+    THEN("a writer for another variant is refused")
+    {
+        auto brandubh = IBoard::fromString(kBrandubh);
+
+        REQUIRE_FALSE(GameRecordWriter::open(path.string(), "brandubh", *brandubh));
+    }
+
+    reader.reset();
+    std::filesystem::remove(path);
+}
+
+SCENARIO("a file without games can be read")
+{
+    auto path = std::filesystem::temp_directory_path() / "tafl-test-no-games.bin";
+    std::filesystem::remove(path);
+
+    auto start = IBoard::fromString(kBrandubh);
+    REQUIRE(GameRecordWriter::open(path.string(), "brandubh", *start));
+
+    auto reader = GameRecordReader::open(path.string());
+    REQUIRE(reader);
+
+    THEN("it has no games")
+    {
+        REQUIRE(reader->getGameCount() == 0);
+        REQUIRE(reader->verify());
+        REQUIRE_FALSE(reader->getGame(0));
+    }
+
+    reader.reset();
+    std::filesystem::remove(path);
+}
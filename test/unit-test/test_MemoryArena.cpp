@@ -0,0 +1,80 @@
+#include "tests.hpp"
+
+#include <MemoryArena.hpp>
+#include <cstdint>
+
+using namespace tafl;
+
+SCENARIO("memory can be allocated from an arena")
+{
+    MemoryArena arena(1024);
+
+    REQUIRE(arena.size() >= 1024);
+    REQUIRE(arena.used() == 0);
+
+    THEN("allocations are aligned and don't overlap")
+    {
+        auto a = static_cast<char*>(arena.allocate(3, 1));
+        auto b = static_cast<char*>(arena.allocate(8, 64));
+
+        REQUIRE(a);
+        REQUIRE(b);
+        REQUIRE(b >= a + 3);
+        REQUIRE(reinterpret_cast<uintptr_t>(b) % 64 == 0);
+    }
+
+    THEN("objects can be created in the arena")
+    {
+        auto p = arena.create<uint64_t>(17u);
+
+        REQUIRE(p);
+        REQUIRE(*p == 17);
+    }
+
+    THEN("allocations fail when the arena is full")
+    {
+        REQUIRE(arena.allocate(arena.size()));
+        REQUIRE_FALSE(arena.allocate(1));
+
+        AND_THEN("the memory can be reused after a reset")
+        {
+            arena.reset();
+
+            REQUIRE(arena.used() == 0);
+            REQUIRE(arena.allocate(arena.size()));
+        }
+    }
+}
+
+SCENARIO("an arena which can't be mapped is empty")
+{
+    MemoryArena arena(size_t {1} << 62);
+
+    REQUIRE(arena.size() == 0);
+    REQUIRE_FALSE(arena.allocate(1));
+    REQUIRE_FALSE(arena.create<uint64_t>(17u));
+}
+
+SCENARIO("arenas are leased from a pool")
+{
+    auto lease = MemoryArena::acquire(1024);
+    REQUIRE(lease);
+    REQUIRE(lease->size() >= 1024);
+
+    auto arena = lease.get();
+    REQUIRE(lease->allocate(64));
+
+    THEN("a returned arena is reused for the same size, reset")
+    {
+        lease.reset();
+        auto again = MemoryArena::acquire(1024);
+
+        REQUIRE(again.get() == arena);
+        REQUIRE(again->used() == 0);
+    }
+
+    THEN("an arena which can't be mapped isn't leased")
+    {
+        REQUIRE_FALSE(MemoryArena::acquire(size_t {1} << 62));
+    }
+}
@@ -2,6 +2,7 @@
 #include "tests.hpp"
 
 #include <IBoard.hpp>
+#include <algorithm>
 
 using namespace tafl;
 using namespace tafl::ut;
@@ -133,3 +134,364 @@ SCENARIO("black can stop white from winning")
         }
     }
 }
+
+SCENARIO("a search reports the statistics of the moves")
+{
+    auto b = IBoard::fromString(kTablut);
+
+    SearchConfig config;
+    config.quota = 200ms;
+    config.threads = 2;
+
+    auto result = b->search(config).get();
+
+    THEN("all moves are reported, the most visited first")
+    {
+        REQUIRE(result.playouts > 0);
+        REQUIRE(result.moves.size() == b->getPossibleMoves().size());
+        REQUIRE(result.bestMove == result.moves.front().move);
+
+        for (auto i = 1u; i < result.moves.size(); i++)
+        {
+            REQUIRE(result.moves[i - 1].visits >= result.moves[i].visits);
+        }
+    }
+}
+
+SCENARIO("a search continues when the tree memory runs out")
+{
+    auto b = IBoard::fromString(kTablut);
+
+    // Enough playouts to run out, however long they take
+    SearchConfig config;
+    config.quota = 30s;
+    config.playouts = 4000;
+    config.threads = 2;
+    config.memoryLimit = 64 * 1024;
+
+    auto result = b->search(config).get();
+
+    THEN("subtrees are recycled and the search completes")
+    {
+        REQUIRE(result.recycles > 0);
+        REQUIRE(result.bestMove);
+        REQUIRE(result.moves.size() == b->getPossibleMoves().size());
+    }
+
+    AND_WHEN("the memory for the tree can't be allocated")
+    {
+        config.memoryLimit = size_t {1} << 62;
+
+        auto failed = b->search(config).get();
+
+        THEN("the search returns without a move")
+        {
+            REQUIRE_FALSE(failed.bestMove);
+            REQUIRE(failed.playouts == 0);
+
+            config.seed = 1;
+            REQUIRE_FALSE(b->search(config).get().bestMove);
+        }
+    }
+}
+
+SCENARIO("a search shares the statistics of transposed positions")
+{
+    // The king and a white piece moving around inside a black wall
+    auto b = IBoard::fromString("bbbbb"
+                                "b   b"
+                                "b k b"
+                                "b w b"
+                                "bbbbb");
+
+    SearchConfig config;
+    config.quota = 300ms;
+    config.threads = 2;
+
+    auto result = b->search(config).get();
+
+    THEN("positions reached by different move orders are merged")
+    {
+        REQUIRE(result.transpositions > 0);
+        REQUIRE(result.moves.size() == b->getPossibleMoves().size());
+    }
+}
+
+SCENARIO("a search continues from the subtree of the played moves")
+{
+    auto b = IBoard::fromString(kTablut);
+
+    SearchConfig config;
+    config.quota = 200ms;
+    config.threads = 2;
+
+    auto first = b->search(config).get();
+    REQUIRE(first.reusedVisits == 0);
+
+    WHEN("the best move is played")
+    {
+        auto visits = first.moves.front().visits;
+
+        b->move(*first.bestMove);
+        auto second = b->search(config).get();
+
+        THEN("the search starts with the visits of its subtree")
+        {
+            REQUIRE(second.reusedVisits == visits);
+            REQUIRE(second.moves.size() == b->getPossibleMoves().size());
+        }
+    }
+
+    WHEN("the position is changed without a move")
+    {
+        b->setTurn(!b->getTurn());
+        auto second = b->search(config).get();
+
+        THEN("the search starts from scratch")
+        {
+            REQUIRE(second.reusedVisits == 0);
+        }
+    }
+}
+
+SCENARIO("a search proves forced results")
+{
+    SearchConfig config;
+    config.quota = 10s;
+    config.threads = 2;
+
+    WHEN("the king can step onto an edge square")
+    {
+        auto b = IBoard::fromString(" w b "
+                                    " wb  "
+                                    " k  b"
+                                    "bb   "
+                                    "   b ");
+        b->setTurn(Color::White);
+
+        auto result = b->search(config).get();
+
+        THEN("the winning move is proven and the search stops early")
+        {
+            REQUIRE(result.elapsed < config.quota);
+            REQUIRE(result.moves.front().outcome == Outcome::Win);
+
+            b->move(*result.bestMove);
+            REQUIRE(b->getWinner() == Color::White);
+        }
+    }
+
+    WHEN("black can't stop the king from escaping")
+    {
+        auto b = IBoard::fromString("       "
+                                    " k     "
+                                    "       "
+                                    "       "
+                                    "     b "
+                                    "    b  "
+                                    "       ");
+        b->setTurn(Color::Black);
+
+        auto result = b->search(config).get();
+
+        THEN("all moves are proven to lose")
+        {
+            REQUIRE(result.elapsed < config.quota);
+            REQUIRE(result.moves.size() == b->getPossibleMoves().size());
+            for (auto& move : result.moves)
+            {
+                REQUIRE(move.outcome == Outcome::Loss);
+            }
+        }
+    }
+}
+
+SCENARIO("a search consults a proof-number search on the positions visited often")
+{
+    // The king can open two lines to the edges, and black can block only one of them
+    auto b = IBoard::fromString("  b b  "
+                                "       "
+                                "b k   b"
+                                "       "
+                                "       "
+                                "       "
+                                "  b b  ");
+    b->setTurn(Color::White);
+
+    SearchConfig config;
+    config.threads = 1;
+    config.playouts = 400;
+    config.seed = 3;
+
+    auto result = b->search(config).get();
+
+    THEN("a winning move is proven within a few hundred playouts")
+    {
+        REQUIRE(result.moves.front().outcome == Outcome::Win);
+
+        // It doesn't win at once, so the search had to look beyond the replies
+        b->move(*result.bestMove);
+        REQUIRE_FALSE(b->getWinner());
+        REQUIRE(b->prove({Color::White, 1, 100000}).proof == Proof::Proven);
+    }
+}
+
+SCENARIO("a search merges symmetric moves")
+{
+    auto b = IBoard::fromString(kTablut);
+    const auto dim = b->getBoardDimension();
+
+    SearchConfig config;
+    config.quota = 200ms;
+    config.threads = 2;
+
+    auto result = b->search(config).get();
+
+    THEN("the mirrored moves share their statistics")
+    {
+        auto mirror = [dim](const Pos& pos) { return Pos {dim - 1 - pos.x, pos.y}; };
+
+        REQUIRE(result.moves.size() == b->getPossibleMoves().size());
+        for (auto& stats : result.moves)
+        {
+            auto mirrored = std::ranges::find_if(result.moves, [&](const MoveStatistics& m) {
+                return m.move == Move {mirror(stats.move.from), mirror(stats.move.to)};
+            });
+
+            REQUIRE(mirrored != result.moves.end());
+            REQUIRE(mirrored->visits == stats.visits);
+        }
+    }
+}
+
+SCENARIO("a seeded search with a number of playouts is reproducible")
+{
+    SearchConfig config;
+    config.threads = 2;
+    config.playouts = 2000;
+    config.seed = 42;
+
+    auto search = [&config]() {
+        auto b = IBoard::fromString(kTablut);
+
+        return b->search(config).get();
+    };
+
+    auto first = search();
+    auto second = search();
+
+    THEN("the playouts, the best move and the statistics are the same")
+    {
+        REQUIRE(first.playouts == config.playouts);
+        REQUIRE(second.playouts == config.playouts);
+        REQUIRE(first.bestMove == second.bestMove);
+        REQUIRE(first.moves.size() == second.moves.size());
+
+        for (auto i = 0u; i < first.moves.size(); i++)
+        {
+            REQUIRE(first.moves[i].move == second.moves[i].move);
+            REQUIRE(first.moves[i].visits == second.moves[i].visits);
+            REQUIRE(first.moves[i].winRate == second.moves[i].winRate);
+        }
+    }
+
+    AND_WHEN("the search isn't seeded")
+    {
+        config.seed.reset();
+
+        auto result = search();
+
+        THEN("it still stops after the playouts")
+        {
+            REQUIRE(result.playouts == config.playouts);
+        }
+    }
+
+    AND_WHEN("the playouts use the patterns")
+    {
+        config.patternPlayouts = true;
+
+        auto patterns = search();
+
+        THEN("they are just as reproducible")
+        {
+            auto again = search();
+
+            REQUIRE(patterns.playouts == config.playouts);
+            REQUIRE(patterns.bestMove == again.bestMove);
+            REQUIRE(patterns.moves.size() == again.moves.size());
+
+            for (auto i = 0u; i < patterns.moves.size(); i++)
+            {
+                REQUIRE(patterns.moves[i].visits == again.moves[i].visits);
+                REQUIRE(patterns.moves[i].winRate == again.moves[i].winRate);
+            }
+        }
+    }
+}
+
+SCENARIO("a search reports its progress")
+{
+    auto b = IBoard::fromString(kTablut);
+
+    SearchConfig config;
+    config.quota = 300ms;
+    config.threads = 2;
+    config.progressInterval = 20ms;
+    config.principalVariations = 2;
+
+    std::vector<SearchProgress> snapshots;
+    config.onProgress = [&snapshots](const SearchProgress& progress) {
+        snapshots.push_back(progress);
+        return true;
+    };
+
+    auto result = b->search(config).get();
+
+    THEN("snapshots with the best moves and their lines are published")
+    {
+        REQUIRE(snapshots.size() > 2);
+        REQUIRE(snapshots.back().playouts <= result.playouts);
+
+        for (auto& progress : snapshots)
+        {
+            if (!progress.bestMove)
+            {
+                continue;
+            }
+            REQUIRE(progress.bestMove == progress.moves.front().move);
+            REQUIRE(progress.principalVariations.size() == 2);
+
+            for (auto i = 0u; i < progress.principalVariations.size(); i++)
+            {
+                auto& line = progress.principalVariations[i];
+                auto board = b->clone();
+
+                REQUIRE(line.front() == progress.moves[i].move);
+                for (auto& move : line)
+                {
+                    auto moves = board->getPossibleMoves();
+
+                    REQUIRE(std::ranges::find(moves, move) != moves.end());
+                    board->move(move);
+                }
+            }
+        }
+    }
+
+    AND_WHEN("the callback asks to stop")
+    {
+        config.quota = 10s;
+        config.onProgress = [](const SearchProgress& progress) {
+            return progress.playouts == 0;
+        };
+
+        auto stopped = b->search(config).get();
+
+        THEN("the search stops early with the result so far")
+        {
+            REQUIRE(stopped.elapsed < 5s);
+            REQUIRE(stopped.bestMove);
+        }
+    }
+}
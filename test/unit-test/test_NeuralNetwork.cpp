@@ -0,0 +1,211 @@
+#include "BoardHelper.hpp"
+#include "tests.hpp"
+
+#include <IBoard.hpp>
+#include <NeuralNetwork.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+using namespace tafl;
+using namespace tafl::ut;
+
+namespace
+{
+
+// Small random weights, so that the accumulator doesn't overflow
+NeuralNetwork::Parameters
+randomParameters(unsigned dimension)
+{
+    NeuralNetwork::Parameters out;
+    uint32_t random = 3;
+    auto next = [&random](int range) {
+        random = random * 1664525 + 1013904223;
+        return static_cast<int16_t>(static_cast<int>(random >> 16) % (2 * range + 1) - range);
+    };
+
+    out.dimension = dimension;
+    for (auto& bias : out.hiddenBiases)
+    {
+        bias = next(128);
+    }
+    out.hiddenWeights.resize(NeuralNetwork::inputCount(dimension) * NeuralNetwork::kHidden);
+    for (auto& weight : out.hiddenWeights)
+    {
+        weight = next(64);
+    }
+    for (auto& weight : out.outputWeights)
+    {
+        weight = next(128);
+    }
+    out.outputBiases = {1000, -2000};
+
+    return out;
+}
+
+// The output computed the long way, from the pieces of the board
+float
+referenceScore(const NeuralNetwork::Parameters& parameters, const IBoard& board)
+{
+    const auto dim = parameters.dimension;
+    const auto side = board.getTurn() == Color::White ? 0u : 1u;
+    int64_t out = parameters.outputBiases[side];
+
+    for (auto i = 0u; i < NeuralNetwork::kHidden; i++)
+    {
+        int32_t sum = parameters.hiddenBiases[i];
+
+        for (auto y = 0u; y < dim; y++)
+        {
+            for (auto x = 0u; x < dim; x++)
+            {
+                if (auto type = board.pieceAt({x, y}))
+                {
+                    auto input = (static_cast<unsigned>(*type) - 1) * dim * dim + y * dim + x;
+                    sum += parameters.hiddenWeights[input * NeuralNetwork::kHidden + i];
+                }
+            }
+        }
+
+        out += std::clamp(sum, 0, NeuralNetwork::kActivationMax) *
+               parameters.outputWeights[side * NeuralNetwork::kHidden + i];
+    }
+
+    return static_cast<float>(out) /
+           (NeuralNetwork::kActivationMax * NeuralNetwork::kWeightScale);
+}
+
+} // namespace
+
+SCENARIO("a network evaluates positions")
+{
+    auto network = NeuralNetwork::create(randomParameters(7));
+    REQUIRE(network);
+
+    auto board = IBoard::fromString(kBrandubh);
+    board->setTurn(Color::Black);
+
+    THEN("the output is the same as computed the long way")
+    {
+        NeuralNetwork::Accumulator accumulator;
+        network->refresh(*board, accumulator);
+
+        REQUIRE(network->score(accumulator, Color::Black) ==
+                doctest::Approx(referenceScore(network->getParameters(), *board)));
+        REQUIRE(network->winRate(*board, Color::Black) ==
+                doctest::Approx(1 - network->winRate(*board, Color::White)));
+    }
+
+    THEN("a board keeps it up to date as pieces are moved and captured")
+    {
+        REQUIRE(board->attachNetwork(network.get()));
+
+        // The same as from a full refresh, before and after each move
+        auto matches = [&board, &network]() {
+            NeuralNetwork::Accumulator refreshed;
+            network->refresh(*board, refreshed);
+
+            return board->getNetworkScore() == network->score(refreshed, board->getTurn());
+        };
+        auto captures =
+            playRandomGame(*board, 5, 80, [&matches](const Move&) { REQUIRE(matches()); });
+
+        REQUIRE(matches());
+        REQUIRE(captures > 0);
+
+        REQUIRE(board->attachNetwork(nullptr));
+        REQUIRE_FALSE(board->getNetworkScore());
+        REQUIRE_FALSE(board->attachNetwork(NeuralNetwork::create(randomParameters(9)).get()));
+    }
+
+    THEN("a search can score its playouts with the network")
+    {
+        SearchConfig config;
+        config.threads = 2;
+        config.playouts = 2000;
+        config.network = std::move(network);
+        config.playoutDepth = 8;
+
+        auto result = board->search(config).get();
+
+        REQUIRE(result.bestMove);
+        REQUIRE(result.playouts == config.playouts);
+    }
+}
+
+SCENARIO("the AVX2 kernels compute the same as the plain loops")
+{
+    auto network = NeuralNetwork::create(randomParameters(9));
+    REQUIRE(network);
+
+    // The scores along a game from the board, from a refresh and computed the long way
+    auto play = [&network]() {
+        auto board = IBoard::fromString(kTablut);
+        board->setTurn(Color::Black);
+        board->attachNetwork(network.get());
+        std::vector<std::array<float, 3>> out;
+        auto record = [&]() {
+            NeuralNetwork::Accumulator refreshed;
+            network->refresh(*board, refreshed);
+            out.push_back({*board->getNetworkScore(),
+                           network->score(refreshed, board->getTurn()),
+                           referenceScore(network->getParameters(), *board)});
+        };
+
+        playRandomGame(*board, 7, 120, [&record](const Move&) { record(); });
+        record();
+
+        return out;
+    };
+
+    REQUIRE_FALSE(NeuralNetwork::useAvx2(false));
+    auto scalar = play();
+    REQUIRE(NeuralNetwork::useAvx2(true) == NeuralNetwork::hasAvx2());
+    auto avx2 = play();
+
+    THEN("the plain loops match the output computed the long way")
+    {
+        for (auto& [incremental, refreshed, reference] : scalar)
+        {
+            REQUIRE(incremental == refreshed);
+            REQUIRE(incremental == doctest::Approx(reference));
+        }
+    }
+
+    THEN("the kernels of the processor match the plain loops")
+    {
+        REQUIRE(avx2 == scalar);
+    }
+}
+
+SCENARIO("networks are written and read back")
+{
+    auto network = NeuralNetwork::create(randomParameters(9));
+    REQUIRE(network);
+
+    auto bytes = network->toBytes();
+
+    THEN("the weights are the same")
+    {
+        auto read = NeuralNetwork::fromBytes(bytes);
+
+        REQUIRE(read);
+        REQUIRE(read->getParameters().dimension == 9);
+        REQUIRE(read->getParameters().hiddenWeights == network->getParameters().hiddenWeights);
+        REQUIRE(read->getParameters().outputBiases == network->getParameters().outputBiases);
+        REQUIRE(read->toBytes() == bytes);
+    }
+
+    THEN("invalid files are refused")
+    {
+        auto truncated = bytes;
+        truncated.pop_back();
+        auto wrongMagic = bytes;
+        wrongMagic[0] = 'X';
+
+        REQUIRE_FALSE(NeuralNetwork::fromBytes(truncated));
+        REQUIRE_FALSE(NeuralNetwork::fromBytes(wrongMagic));
+        REQUIRE_FALSE(NeuralNetwork::create(randomParameters(0)));
+    }
+}
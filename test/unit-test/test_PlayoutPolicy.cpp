@@ -0,0 +1,129 @@
+#include "BoardHelper.hpp"
+#include "tests.hpp"
+
+#include <IBoard.hpp>
+#include <PlayoutPolicy.hpp>
+#include <array>
+#include <optional>
+#include <utility>
+
+using namespace tafl;
+using namespace tafl::ut;
+
+namespace
+{
+
+// The pattern of a square computed from the pieces around it, with a square taken as empty
+uint16_t
+referencePattern(const IBoard& board, const Pos& pos, std::optional<Pos> empty = std::nullopt)
+{
+    constexpr std::array<std::pair<int, int>, PlayoutPolicy::kDirections> kSteps {
+        {{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+    const auto dim = board.getBoardDimension();
+    uint16_t out = 0;
+
+    for (auto direction = 0u; direction < PlayoutPolicy::kDirections; direction++)
+    {
+        auto [dx, dy] = kSteps[direction];
+
+        for (auto distance = 1; distance <= 2; distance++)
+        {
+            // Off the board wraps around to large coordinates
+            auto at = Pos {pos.x + dx * distance, pos.y + dy * distance};
+            if (at.x >= dim || at.y >= dim || at == empty)
+            {
+                continue;
+            }
+
+            if (auto type = board.pieceAt(at))
+            {
+                out |= PlayoutPolicy::code(*type) << PlayoutPolicy::shift(direction, distance);
+            }
+        }
+    }
+
+    return out;
+}
+
+} // namespace
+
+SCENARIO("the patterns of the squares are kept up to date")
+{
+    auto board = IBoard::fromString(kTablut);
+    const auto dim = board->getBoardDimension();
+
+    REQUIRE_FALSE(board->getPattern({0, 0}));
+    board->attachPatterns(true);
+
+    auto allMatch = [&board, dim]() {
+        for (auto y = 0u; y < dim; y++)
+        {
+            for (auto x = 0u; x < dim; x++)
+            {
+                if (board->getPattern({x, y}) != referencePattern(*board, {x, y}))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    };
+
+    THEN("they are the same as computed from the pieces as moves and captures are played")
+    {
+        auto captures = playRandomGame(*board, 11, 200, [&](const Move& move) {
+            REQUIRE(allMatch());
+
+            // The destination once the piece has left its square
+            REQUIRE(PlayoutPolicy::afterMove(*board->getPattern(move.to), move) ==
+                    referencePattern(*board, move.to, move.from));
+        });
+
+        REQUIRE(allMatch());
+        REQUIRE(captures > 0);
+    }
+
+    THEN("copies keep them, and they are dropped once detached")
+    {
+        board->move(*board->getRandomMove(0));
+        auto copy = board->clone();
+
+        REQUIRE(copy->getPattern({4, 3}) == board->getPattern({4, 3}));
+
+        board->attachPatterns(false);
+        REQUIRE_FALSE(board->getPattern({4, 3}));
+    }
+}
+
+SCENARIO("the weights of the moves follow the pieces around their destinations")
+{
+    auto row = [](Piece::Type right1, Piece::Type right2, Piece::Type left1) {
+        return static_cast<uint16_t>(PlayoutPolicy::code(right1) << PlayoutPolicy::shift(0, 1) |
+                                     PlayoutPolicy::code(right2) << PlayoutPolicy::shift(0, 2) |
+                                     PlayoutPolicy::code(left1) << PlayoutPolicy::shift(1, 1));
+    };
+    const auto none = Piece::Type::Unset;
+    const auto base = PlayoutPolicy::weight(Color::Black, 0);
+
+    THEN("captures and closing in on the king are preferred")
+    {
+        auto capture = row(Piece::Type::White, Piece::Type::Black, none);
+        auto king = row(Piece::Type::King, none, none);
+
+        REQUIRE(PlayoutPolicy::weight(Color::Black, capture) > base);
+        REQUIRE(PlayoutPolicy::weight(Color::Black, king) > base);
+        REQUIRE(PlayoutPolicy::weight(Color::White, king) ==
+                PlayoutPolicy::weight(Color::White, 0));
+    }
+
+    THEN("moves where the piece can be captured next are avoided")
+    {
+        auto exposed = row(Piece::Type::White, none, none);
+        auto covered = row(Piece::Type::White, none, Piece::Type::Black);
+
+        REQUIRE(PlayoutPolicy::weight(Color::Black, exposed) < base);
+        REQUIRE(PlayoutPolicy::weight(Color::Black, covered) == base);
+        REQUIRE(PlayoutPolicy::weight(Color::Black, exposed) >= 1);
+    }
+}
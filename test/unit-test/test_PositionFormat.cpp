@@ -0,0 +1,81 @@
+#include "tests.hpp"
+
+#include <IBoard.hpp>
+#include <PositionFormat.hpp>
+#include <array>
+
+using namespace tafl;
+
+SCENARIO("positions are packed into a few bytes")
+{
+    auto board = IBoard::fromString(kTablut);
+    board->setTurn(Color::Black);
+
+    std::array<uint8_t, PositionFormat::packedSize(9)> packed;
+    REQUIRE(packed.size() == 21);
+    REQUIRE(PositionFormat::pack(*board, packed));
+
+    THEN("they unpack to the same position and turn")
+    {
+        auto unpacked = PositionFormat::unpack(packed, 9);
+
+        REQUIRE(unpacked);
+        REQUIRE(PositionFormat::toText(*unpacked) == PositionFormat::toText(*board));
+        REQUIRE(unpacked->getPossibleMoves() == board->getPossibleMoves());
+    }
+
+    AND_WHEN("a position is unpacked into a board in use")
+    {
+        auto reused = IBoard::fromString(kTablut);
+        reused->move(reused->getPossibleMoves().front());
+
+        REQUIRE(PositionFormat::unpack(packed, *reused));
+
+        THEN("the position is replaced")
+        {
+            REQUIRE(PositionFormat::toText(*reused) == PositionFormat::toText(*board));
+            REQUIRE(reused->getPieceCount(Color::Black) == 16);
+            REQUIRE(reused->getKingPosition() == Pos {4, 4});
+        }
+    }
+
+    THEN("a buffer or an input which is too small is rejected")
+    {
+        std::array<uint8_t, 20> small;
+
+        REQUIRE_FALSE(PositionFormat::pack(*board, small));
+        REQUIRE_FALSE(PositionFormat::unpack(small, 9));
+    }
+}
+
+SCENARIO("positions have a text form with the turn")
+{
+    THEN("the turn follows the board, and is white by default")
+    {
+        auto black = PositionFormat::fromText(kBrandubh + ";b");
+        auto white = PositionFormat::fromText(kBrandubh);
+
+        REQUIRE(black);
+        REQUIRE(black->getTurn() == Color::Black);
+        REQUIRE(white);
+        REQUIRE(white->getTurn() == Color::White);
+        REQUIRE(PositionFormat::toText(*black) == kBrandubh + ";b");
+    }
+
+    THEN("invalid positions are rejected")
+    {
+        REQUIRE_FALSE(PositionFormat::fromText("bwk"));
+        REQUIRE_FALSE(PositionFormat::fromText(kBrandubh + ";x"));
+    }
+}
+
+SCENARIO("files of packed positions have a header")
+{
+    auto header = PositionFormat::header(11);
+
+    REQUIRE(PositionFormat::isHeaderStart(header[0]));
+    REQUIRE(PositionFormat::parseHeader(header) == 11u);
+
+    header[1] = 'x';
+    REQUIRE_FALSE(PositionFormat::parseHeader(header));
+}
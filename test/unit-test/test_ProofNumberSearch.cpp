@@ -0,0 +1,111 @@
+#include "tests.hpp"
+
+#include <IBoard.hpp>
+
+using namespace tafl;
+
+SCENARIO("a proof-number search proves forced wins")
+{
+    WHEN("the king can step onto an edge square")
+    {
+        auto b = IBoard::fromString(" w b "
+                                    " wb  "
+                                    " k  b"
+                                    "bb   "
+                                    "   b ");
+        b->setTurn(Color::White);
+
+        ProofConfig config;
+        config.attacker = Color::White;
+        config.moves = 1;
+
+        auto result = b->prove(config);
+
+        THEN("the win is proven with the escape")
+        {
+            REQUIRE(result.proof == Proof::Proven);
+            REQUIRE(result.move);
+
+            b->move(*result.move);
+            REQUIRE(b->getWinner() == Color::White);
+        }
+
+        AND_THEN("black can't capture the king in one move")
+        {
+            config.attacker = Color::Black;
+            b->setTurn(Color::Black);
+
+            REQUIRE(b->prove(config).proof == Proof::Disproven);
+        }
+    }
+
+    WHEN("black can't stop the king from escaping")
+    {
+        auto b = IBoard::fromString("       "
+                                    " k     "
+                                    "       "
+                                    "       "
+                                    "     b "
+                                    "    b  "
+                                    "       ");
+        b->setTurn(Color::Black);
+
+        ProofConfig config;
+        config.attacker = Color::White;
+        config.moves = 1;
+
+        THEN("white wins whatever black does")
+        {
+            auto result = b->prove(config);
+
+            REQUIRE(result.proof == Proof::Proven);
+            REQUIRE_FALSE(result.move);
+        }
+    }
+
+    WHEN("black can capture the king in two moves")
+    {
+        auto b = IBoard::fromString("bw b "
+                                    "bk   "
+                                    "b   w"
+                                    " b   "
+                                    "     ");
+        b->setTurn(Color::Black);
+
+        ProofConfig config;
+        config.attacker = Color::Black;
+
+        THEN("it's not possible in one move")
+        {
+            config.moves = 1;
+
+            REQUIRE(b->prove(config).proof == Proof::Disproven);
+        }
+
+        THEN("the first move of the capture is found")
+        {
+            config.moves = 2;
+            auto result = b->prove(config);
+
+            REQUIRE(result.proof == Proof::Proven);
+            REQUIRE(result.move);
+        }
+    }
+
+    WHEN("the node limit is too low")
+    {
+        auto b = IBoard::fromString(kTablut);
+
+        ProofConfig config;
+        config.moves = 3;
+        config.nodeLimit = 100;
+
+        THEN("the result is unknown")
+        {
+            auto result = b->prove(config);
+
+            REQUIRE(result.proof == Proof::Unknown);
+            REQUIRE(result.nodes >= config.nodeLimit);
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#include "tests.hpp"
+
+#include <IBoard.hpp>
+#include <IMoveTrait.hpp>
+#include <SlidingMoveTable.hpp>
+#include <algorithm>
+#include <set>
+
+using namespace tafl;
+
+namespace
+{
+
+std::set<std::pair<Pos, Pos>>
+toMoveSet(const std::vector<Move>& moves)
+{
+    std::set<std::pair<Pos, Pos>> out;
+    for (auto& m : moves)
+    {
+        out.insert({m.from, m.to});
+    }
+
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("The sliding move table gives the reachable squares on a line")
+{
+    // 0 1 2 3 4, a piece at 2
+    REQUIRE(SlidingMoveTable<5>::reachable(2, 0b00100) == 0b11011);
+    // Blocked at 0 and 4
+    REQUIRE(SlidingMoveTable<5>::reachable(2, 0b10101) == 0b01010);
+    // Blocked next to the piece
+    REQUIRE(SlidingMoveTable<5>::reachable(2, 0b01110) == 0);
+    // At the edge
+    REQUIRE(SlidingMoveTable<5>::reachable(0, 0b01001) == 0b00110);
+    REQUIRE(SlidingMoveTable<5>::reachable(4, 0b10000) == 0b01111);
+
+    REQUIRE(slidingMoveTable(9).size() == 9 * 512);
+    REQUIRE(slidingMoveTable(18).empty());
+}
+
+SCENARIO("table-based move generation matches the move trait")
+{
+    auto trait = IMoveTrait::create();
+
+    for (auto& s : {kTablut,
+                    std::string {"    b w  "
+                                 "   wb    "
+                                 "      w  "
+                                 "b    w b "
+                                 "b  w  kbb"
+                                 "  b  w b "
+                                 "b w b    "
+                                 " b       "
+                                 " b b b  w"},
+                    std::string {" w b "
+                                 " wb  "
+                                 " k  b"
+                                 "bb   "
+                                 "   b "}})
+    {
+        auto b = IBoard::fromString(s);
+        REQUIRE(b);
+
+        for (auto turn : {Color::White, Color::Black})
+        {
+            b->setTurn(turn);
+
+            std::vector<Move> expected;
+            b->forEachPiece(turn, [&](const Piece& p) {
+                auto m = trait->getMoves(*b, p);
+                expected.insert(expected.end(), m.begin(), m.end());
+            });
+
+            auto moves = b->getPossibleMoves();
+
+            REQUIRE(moves.size() == expected.size());
+            REQUIRE(toMoveSet(moves) == toMoveSet(expected));
+        }
+    }
+}
@@ -0,0 +1,153 @@
+#include "tests.hpp"
+
+#include <IBoard.hpp>
+#include <Tablebase.hpp>
+#include <filesystem>
+
+using namespace tafl;
+
+SCENARIO("tablebases solve positions with few pieces")
+{
+    auto directory = std::filesystem::temp_directory_path() / "tafl-test-tablebases";
+    std::filesystem::remove_all(directory);
+
+    REQUIRE(Tablebases::generate(5, 1, 2, directory.string(), 4));
+
+    // 2 entries for each position of the king and the pieces, for each turn
+    REQUIRE(Tablebases::generatedSize(5, 0, 0) == 25 * 2);
+    REQUIRE(Tablebases::generatedSize(5, 1, 0) == 25 * 2 + 25 * 25 * 2);
+
+    // The king with 0 or 1 white pieces and 0 to 2 black pieces
+    REQUIRE(Tablebases::load(directory.string()) == 6);
+
+    WHEN("the king has an open line to an edge")
+    {
+        auto b = IBoard::fromString("     "
+                                    " k   "
+                                    "   b "
+                                    "    b"
+                                    "     ");
+        b->setTurn(Color::White);
+
+        THEN("white wins with the next move")
+        {
+            auto result = b->probeTablebase();
+
+            REQUIRE(result);
+            REQUIRE(result->winner == Color::White);
+            REQUIRE(result->plies == 1);
+        }
+    }
+
+    WHEN("black can sandwich the king")
+    {
+        auto b = IBoard::fromString("     "
+                                    " b   "
+                                    " k   "
+                                    "   b "
+                                    "     ");
+        b->setTurn(Color::Black);
+
+        THEN("black wins with the next move")
+        {
+            auto result = b->probeTablebase();
+
+            REQUIRE(result);
+            REQUIRE(result->winner == Color::Black);
+            REQUIRE(result->plies == 1);
+        }
+    }
+
+    WHEN("a position has more pieces than the tablebases")
+    {
+        auto b = IBoard::fromString("  b  "
+                                    " b   "
+                                    " k   "
+                                    "   b "
+                                    "     ");
+
+        THEN("it isn't found")
+        {
+            REQUIRE_FALSE(b->probeTablebase());
+        }
+    }
+
+    WHEN("positions are solved by a proof-number search")
+    {
+        const std::vector<std::string> boards {"  wb "
+                                               "b k  "
+                                               "     "
+                                               "     "
+                                               "     ",
+                                               "  w b"
+                                               "b k  "
+                                               "     "
+                                               "     "
+                                               "     ",
+                                               "  w  "
+                                               " bkb "
+                                               "     "
+                                               "     "
+                                               "     ",
+                                               "     "
+                                               "  b  "
+                                               " wk  "
+                                               "  b  "
+                                               "     "};
+
+        THEN("the results and the plies agree")
+        {
+            for (auto& s : boards)
+            {
+                for (auto turn : {Color::White, Color::Black})
+                {
+                    auto b = IBoard::fromString(s);
+                    b->setTurn(turn);
+
+                    auto result = b->probeTablebase();
+                    REQUIRE(result);
+
+                    // The moves of the winner, who moves first if it's their turn
+                    ProofConfig config;
+                    config.attacker = result->winner;
+                    config.moves = turn == result->winner ? (result->plies + 1) / 2
+                                                          : result->plies / 2;
+
+                    REQUIRE(b->prove(config).proof == Proof::Proven);
+
+                    if (config.moves > 1)
+                    {
+                        config.moves--;
+                        REQUIRE(b->prove(config).proof == Proof::Disproven);
+                    }
+                }
+            }
+        }
+    }
+
+    WHEN("the tablebases would take too much memory")
+    {
+        auto large = directory / "large";
+
+        THEN("they aren't generated")
+        {
+            REQUIRE(Tablebases::generatedSize(8, 4, 4) > Tablebases::kMaxGeneratedSize);
+            REQUIRE_FALSE(Tablebases::generate(8, 4, 4, large.string(), 4));
+            REQUIRE_FALSE(std::filesystem::exists(large));
+        }
+    }
+
+    Tablebases::unload();
+    std::filesystem::remove_all(directory);
+
+    THEN("unloaded tablebases aren't probed")
+    {
+        auto b = IBoard::fromString("     "
+                                    " k   "
+                                    "     "
+                                    "     "
+                                    "     ");
+
+        REQUIRE_FALSE(b->probeTablebase());
+    }
+}
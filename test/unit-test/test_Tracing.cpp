@@ -0,0 +1,93 @@
+#include "tests.hpp"
+
+#include <IBoard.hpp>
+#include <Tracing.hpp>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <set>
+#include <sstream>
+#include <thread>
+
+using namespace tafl;
+
+SCENARIO("the phases of a search are traced if it's compiled in")
+{
+    auto path = std::filesystem::temp_directory_path() / "tafl-test-trace.json";
+    std::filesystem::remove(path);
+
+    Tracing::reset();
+
+    auto b = IBoard::fromString(kTablut);
+
+    SearchConfig config;
+    config.threads = 2;
+    config.playouts = 200;
+    b->search(config).get();
+
+    if (!Tracing::isEnabled())
+    {
+        THEN("nothing is recorded")
+        {
+            REQUIRE(Tracing::formatHistograms().find("playout") == std::string::npos);
+            REQUIRE_FALSE(Tracing::writeChromeTrace(path.string()));
+        }
+    }
+    else
+    {
+        THEN("the histograms and the trace events show the phases")
+        {
+            REQUIRE(Tracing::formatHistograms().find("playout") != std::string::npos);
+            REQUIRE(Tracing::writeChromeTrace(path.string()));
+
+            std::ifstream in(path);
+            std::stringstream json;
+            json << in.rdbuf();
+
+            REQUIRE(json.str().starts_with("{\"displayTimeUnit\""));
+            REQUIRE(json.str().find("\"name\":\"scan captures\"") != std::string::npos);
+        }
+
+        THEN("threads which start after a reset don't share the ids of live threads")
+        {
+            auto record = [&b]() {
+                auto copy = b->clone();
+                copy->move(*copy->getRandomMove(0));
+            };
+            std::promise<void> recorded;
+            std::promise<void> done;
+
+            // Start from the traces of the live threads only
+            Tracing::reset();
+            std::thread(record).join();
+            std::thread live([&record, &recorded, &done]() {
+                record();
+                recorded.set_value();
+                done.get_future().wait();
+            });
+            recorded.get_future().wait();
+
+            // Drops the trace of the exited thread, but not the one of the live thread
+            Tracing::reset();
+            std::thread(record).join();
+
+            std::istringstream histograms(Tracing::formatHistograms());
+            std::multiset<std::string> ids;
+            for (std::string line; std::getline(histograms, line);)
+            {
+                if (line.starts_with("thread "))
+                {
+                    ids.insert(line);
+                }
+            }
+            done.set_value();
+            live.join();
+
+            REQUIRE(ids.size() >= 2);
+            REQUIRE(std::set<std::string>(ids.begin(), ids.end()).size() == ids.size());
+        }
+    }
+
+    Tracing::reset();
+    std::filesystem::remove(path);
+}